@@ -0,0 +1,121 @@
+// Micro-benchmark: text ORDER message parse time, before and after the
+// single-pass parser. Build with optimizations for meaningful numbers:
+//   cmake -S . -B build -DCMAKE_BUILD_TYPE=Release && cmake --build build --target order_parse_benchmark
+//   ./build/order_parse_benchmark [iterations]
+
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <algorithm>
+#include <cstdlib>
+#include "OrderParser.h"
+
+namespace {
+// The previous parser, kept as the baseline: the message was split into a
+// vector of strings once to count fields and again to parse, and numbers went
+// through std::stod / std::stoull
+std::vector<std::string> legacyTokenize(const std::string& message) {
+    std::istringstream iss(message.substr(6));
+    std::string token;
+    std::vector<std::string> tokens;
+    while (std::getline(iss, token, ':')) {
+        token.erase(std::remove(token.begin(), token.end(), '\n'), token.end());
+        token.erase(std::remove(token.begin(), token.end(), '\r'), token.end());
+        if (!token.empty()) {
+            tokens.push_back(token);
+        }
+    }
+    return tokens;
+}
+
+bool legacyParse(const std::string& message, Order& order) {
+    if (legacyTokenize(message).size() < 6) {
+        return false;
+    }
+    std::vector<std::string> tokens = legacyTokenize(message);
+    order.traderId = tokens[0];
+    order.traderKey = TraderRegistry::instance().intern(order.traderId);
+    order.symbol = SymbolRegistry::instance().intern(tokens[1]);
+    order.side = (tokens[2] == "BUY") ? OrderSide::BUY : OrderSide::SELL;
+    if (tokens[3] == "MARKET") {
+        order.type = OrderType::MARKET;
+    } else if (tokens[3] == "STOP") {
+        order.type = OrderType::STOP;
+    } else if (tokens[3] == "STOP_LIMIT") {
+        order.type = OrderType::STOP_LIMIT;
+    } else {
+        order.type = OrderType::LIMIT;
+    }
+    try {
+        if (!priceToTicks(std::stod(tokens[4]), kDefaultTickSize, order.price)) {
+            order.status = OrderStatus::REJECTED;
+        }
+        order.quantity = std::stod(tokens[5]);
+        for (size_t i = 6; i < tokens.size(); ++i) {
+            if (tokens[i].compare(0, 5, "CLID=") == 0) {
+                order.clientOrderId = std::stoull(tokens[i].substr(5));
+            } else if (tokens[i] == "TIF=IOC") {
+                order.timeInForce = TimeInForce::IOC;
+            } else if (tokens[i].compare(0, 8, "DISPLAY=") == 0) {
+                order.displayQuantity = std::stod(tokens[i].substr(8));
+            } else {
+                order.status = OrderStatus::REJECTED;
+            }
+        }
+    } catch (const std::exception&) {
+        order.status = OrderStatus::REJECTED;
+    }
+    return true;
+}
+
+template <typename Parse>
+double nanosPerMessage(const std::vector<std::string>& messages, size_t iterations, Parse parse) {
+    size_t checksum = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < iterations; ++i) {
+        Order order;
+        parse(messages[i % messages.size()], order);
+        checksum += static_cast<size_t>(order.price) + order.clientOrderId;
+    }
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    if (checksum == 0) {
+        std::cerr << "unexpected checksum" << std::endl; // Keeps the loop from being optimized away
+    }
+    return std::chrono::duration<double, std::nano>(elapsed).count() / static_cast<double>(iterations);
+}
+}
+
+int main(int argc, char* argv[]) {
+    size_t iterations = (argc > 1) ? std::strtoull(argv[1], nullptr, 10) : 2000000;
+    if (iterations == 0) {
+        iterations = 1;
+    }
+
+    const std::vector<std::string> messages = {
+        "ORDER:trader1:AAPL:BUY:LIMIT:150.25:10",
+        "ORDER:trader2:AAPL:SELL:LIMIT:150.30:25:CLID=1001",
+        "ORDER:trader3:MSFT:BUY:LIMIT:310.00:100:CLID=1002:TIF=IOC",
+        "ORDER:trader4:GOOGL:SELL:LIMIT:2800.50:5:CLID=1003:DISPLAY=1",
+    };
+    const TickSizeLookup tickSizeOf = [](SymbolId) { return kDefaultTickSize; };
+
+    // Warm the registries and caches
+    nanosPerMessage(messages, 10000, legacyParse);
+
+    double before = nanosPerMessage(messages, iterations, legacyParse);
+    double after = nanosPerMessage(messages, iterations,
+                                   [&tickSizeOf](const std::string& message, Order& order) {
+                                       parseOrderMessage(message, order, tickSizeOf);
+                                   });
+
+    std::cout << "Text ORDER parse, " << iterations << " messages" << std::endl;
+    std::cout << std::fixed << std::setprecision(1)
+              << "  before (istringstream, stod):    " << std::setw(8) << before << " ns/message\n"
+              << "  after (string_view, from_chars): " << std::setw(8) << after << " ns/message\n"
+              << std::setprecision(2)
+              << "  speedup: " << before / after << "x" << std::endl;
+    return 0;
+}
@@ -2,24 +2,30 @@
 #define ACCOUNT_H
 
 #include <string>
-#include <map>
+#include <vector>
+#include <mutex>
+#include "SymbolRegistry.h"
 
 class Account {
 public:
     Account(const std::string& accountId, double initialBalance = 0.0);
     
     const std::string& getAccountId() const { return accountId_; }
-    double getBalance() const { return balance_; }
+    double getBalance() const;
+    double getPosition(SymbolId symbol) const;
     double getPosition(const std::string& symbol) const;
     
     void deposit(double amount);
     bool withdraw(double amount);
-    void updatePosition(const std::string& symbol, double quantity);
+    // Add quantity to the position in symbol; returns the new position
+    double updatePosition(SymbolId symbol, double quantity);
     
 private:
+    // Accounts are settled from every matching thread that trades them
+    mutable std::mutex mutex_;
     std::string accountId_;
     double balance_;
-    std::map<std::string, double> positions_; // symbol -> quantity
+    std::vector<double> positions_; // SymbolId -> quantity
 };
 
 #endif // ACCOUNT_H
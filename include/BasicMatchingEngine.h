@@ -0,0 +1,417 @@
+#ifndef BASIC_MATCHING_ENGINE_H
+#define BASIC_MATCHING_ENGINE_H
+
+#include <string>
+#include <vector>
+#include <chrono>
+#include <algorithm>
+#include <utility>
+#include <cstdint>
+#include "Trade.h"
+#include "OrderBook.h"
+
+// Listener that ignores every event; lets benchmarks and embedded simulations
+// run the engine with reporting compiled away
+struct NullTradeListener {
+    void onTrade(const Trade&) {}
+};
+
+// Price-time priority matching engine, specialized at compile time on the book
+// type and on a Listener whose onTrade(const Trade&) hook is called directly
+// (and can be inlined). Book must provide bestOrder(side), fillBestOrder(side,
+// quantity), popBestOrder(side), addOrder(order), forEachLevel(side, limit, fn),
+// forEachOrder(side, limit, fn), getTradingPhase(), getIndicativeUncross(),
+// addStopOrder(order), popTriggeredStops(low, high, out), get/setLastTradePrice(),
+// getOrder(id), removeOrder(id) and amendOrder(id, price, quantity), as
+// OrderBook does.
+template <typename Book, typename Listener>
+class BasicMatchingEngine {
+public:
+    // Trade IDs are generated as firstTradeId, firstTradeId + tradeIdStride, ...
+    explicit BasicMatchingEngine(uint64_t firstTradeId = 0, uint64_t tradeIdStride = 1,
+                                 Listener listener = Listener())
+        : listener_(std::move(listener)), nextTradeId_(firstTradeId), tradeIdStride_(tradeIdStride) {}
+
+    // Submit an order for matching; the listener sees each trade
+    std::vector<Trade> submitOrder(Order& order, Book& orderBook) {
+        engineCancels_.clear();
+        engineAmends_.clear();
+        std::vector<Trade> trades;
+        matchOrder(order, orderBook, trades);
+        fireStops(orderBook, trades);
+
+        // Notify about trades
+        for (const auto& trade : trades) {
+            listener_.onTrade(trade);
+        }
+
+        return trades;
+    }
+
+    // Submit a batch of orders for one book, in sequence. Fills are appended to
+    // trades (which the caller clears and reuses); the listener is not called,
+    // so the caller reports the whole batch at once.
+    void submitOrders(Order* orders, size_t count, Book& orderBook, std::vector<Trade>& trades) {
+        engineCancels_.clear();
+        engineAmends_.clear();
+        for (size_t i = 0; i < count; ++i) {
+            matchOrder(orders[i], orderBook, trades);
+            fireStops(orderBook, trades);
+        }
+    }
+
+    // Execute a call auction: fill every order that crosses at the book's
+    // uncross price, in price-time priority on both sides, all at that one
+    // price. Self-trade prevention does not apply to the uncross itself. Fills are appended to trades; the listener is not called. Returns
+    // the executed volume.
+    double uncross(Book& orderBook, std::vector<Trade>& trades) {
+        engineCancels_.clear();
+        engineAmends_.clear();
+        AuctionQuote quote = orderBook.getIndicativeUncross();
+        double remainingVolume = quote.volume;
+        while (remainingVolume > 0) {
+            const Order* bid = orderBook.bestOrder(OrderSide::BUY);
+            const Order* ask = orderBook.bestOrder(OrderSide::SELL);
+            if (!bid || !ask || bid->price < quote.price || ask->price > quote.price) {
+                break;
+            }
+
+            double matchQuantity = std::min(bid->visibleQuantity, ask->visibleQuantity);
+            matchQuantity = std::min(matchQuantity, remainingVolume);
+            trades.push_back(createTrade(*bid, *ask, quote.price, matchQuantity));
+            orderBook.fillBestOrder(OrderSide::BUY, matchQuantity);
+            orderBook.fillBestOrder(OrderSide::SELL, matchQuantity);
+            recordPrint(orderBook, quote.price);
+            remainingVolume -= matchQuantity;
+        }
+        fireStops(orderBook, trades);
+        return quote.volume - remainingVolume;
+    }
+
+    // Replace a resting order's price and total quantity. A replace that does
+    // not cross is an in-place amend in the book (time priority is kept on a
+    // size-down at the same price); one that crosses is matched as an
+    // aggressive order, keeping what had already filled. Fills are appended to
+    // trades; the listener is not called. Returns false if the order is unknown,
+    // an untriggered stop, or already filled beyond quantity. If replaced is
+    // given it receives the order's final state, which is CANCELLED when
+    // self-trade prevention killed a crossing replace.
+    bool replaceOrder(OrderId orderId, Price price, double quantity, Book& orderBook,
+                      std::vector<Trade>& trades, Order* replaced = nullptr) {
+        engineCancels_.clear();
+        engineAmends_.clear();
+        const Order* resting = orderBook.getOrder(orderId);
+        if (!resting || isStop(*resting) || quantity <= resting->filledQuantity) {
+            return false;
+        }
+
+        const bool isBuy = (resting->side == OrderSide::BUY);
+        const Order* opposite = orderBook.bestOrder(isBuy ? OrderSide::SELL : OrderSide::BUY);
+        bool crosses = opposite && (isBuy ? price >= opposite->price : price <= opposite->price);
+        if (!crosses || orderBook.getTradingPhase() == TradingPhase::CALL_AUCTION) {
+            if (!orderBook.amendOrder(orderId, price, quantity)) {
+                return false;
+            }
+            if (replaced) {
+                *replaced = *orderBook.getOrder(orderId);
+            }
+            return true;
+        }
+
+        Order order = *resting;
+        orderBook.removeOrder(orderId);
+        order.price = price;
+        order.quantity = quantity;
+        matchOrder(order, orderBook, trades);
+        fireStops(orderBook, trades);
+        if (replaced) {
+            *replaced = order;
+        }
+        return true;
+    }
+
+    // Orders the engine cancelled on its own during the last submit, replace or
+    // uncross call, other than the orders passed in, with status CANCELLED:
+    // resting orders removed by self-trade prevention or found with nothing
+    // left to show, and triggered stops that could neither fill nor rest
+    const std::vector<Order>& getEngineCancels() const { return engineCancels_; }
+
+    // Resting orders self-trade prevention (DECREMENT_BOTH) shrank during the
+    // last call, as they now stand in the book
+    const std::vector<Order>& getEngineAmends() const { return engineAmends_; }
+
+    Listener& getListener() { return listener_; }
+
+private:
+    Listener listener_;
+    TradeId nextTradeId_;
+    uint64_t tradeIdStride_;
+    std::vector<Order> triggered_; // Stops being fired; reused across calls
+    Price printLow_ = 0;           // Range of trade prices since stops were last fired; 0 if none
+    Price printHigh_ = 0;
+    std::vector<Order> engineCancels_;
+    std::vector<Order> engineAmends_;
+
+    static bool isStop(const Order& order) {
+        return order.type == OrderType::STOP || order.type == OrderType::STOP_LIMIT;
+    }
+
+    // Whether an unfilled remainder may rest in the book (GTC and GTD)
+    static bool canRest(const Order& order) {
+        return order.timeInForce == TimeInForce::GTC || order.timeInForce == TimeInForce::GTD;
+    }
+
+    // Whether a stop would trigger at the book's last trade price
+    static bool stopTriggered(const Order& order, const Book& orderBook) {
+        Price lastPrice = orderBook.getLastTradePrice();
+        if (lastPrice == 0) {
+            return false;
+        }
+        return (order.side == OrderSide::BUY) ? lastPrice >= order.stopPrice
+                                              : lastPrice <= order.stopPrice;
+    }
+
+    // Turn a triggered stop into the order it stands for
+    static void activateStop(Order& order) {
+        order.type = (order.type == OrderType::STOP) ? OrderType::MARKET : OrderType::LIMIT;
+    }
+
+    // Set the book's last trade price and widen the range of prices printed
+    // since stops were last fired
+    void recordPrint(Book& orderBook, Price price) {
+        orderBook.setLastTradePrice(price);
+        if (printHigh_ == 0) {
+            printLow_ = printHigh_ = price;
+        } else {
+            printLow_ = std::min(printLow_, price);
+            printHigh_ = std::max(printHigh_, price);
+        }
+    }
+
+    // Match every stop triggered by the trades so far, including stops those
+    // matches trigger in turn, appending fills to trades. A stop triggers if
+    // any trade printed through its price, not just the last one, so a sweep
+    // across several levels fires everything it passed. Stops that neither
+    // fill nor rest are recorded as engine cancels for their owners.
+    void fireStops(Book& orderBook, std::vector<Trade>& trades) {
+        triggered_.clear();
+        orderBook.popTriggeredStops(printLow_, printHigh_, triggered_);
+        for (size_t next = 0; next < triggered_.size(); ++next) {
+            activateStop(triggered_[next]);
+            matchOrder(triggered_[next], orderBook, trades);
+            if (triggered_[next].status == OrderStatus::CANCELLED) {
+                engineCancels_.push_back(triggered_[next]);
+            }
+            orderBook.popTriggeredStops(printLow_, printHigh_, triggered_);
+        }
+        printLow_ = printHigh_ = 0;
+    }
+
+    // Match an order and rest any limit remainder, appending fills to trades
+    void matchOrder(Order& order, Book& orderBook, std::vector<Trade>& trades) {
+        if (isStop(order)) {
+            if (!stopTriggered(order, orderBook)) {
+                order.status = OrderStatus::PENDING;
+                orderBook.addStopOrder(order);
+                return;
+            }
+            activateStop(order);
+        }
+
+        if (orderBook.getTradingPhase() == TradingPhase::CALL_AUCTION) {
+            // Call phase: limit orders only rest; market, IOC and FOK orders
+            // cannot rest and are cancelled
+            if (order.type == OrderType::MARKET || !canRest(order)) {
+                order.status = OrderStatus::CANCELLED;
+            }
+        } else if (order.timeInForce == TimeInForce::FOK &&
+                   crossingQuantity(order, orderBook) < order.quantity - order.filledQuantity) {
+            // Not enough liquidity to fill it all: kill without touching the book
+            order.status = OrderStatus::CANCELLED;
+        } else {
+            matchAgainstBook(order, orderBook, trades);
+        }
+
+        // Remainders of IOC and FOK orders, and of market orders, never rest
+        if ((!canRest(order) || order.type == OrderType::MARKET) &&
+            order.status != OrderStatus::FILLED) {
+            order.status = OrderStatus::CANCELLED;
+        }
+
+        // If order is not fully filled and it's a limit order, add to order book
+        if (order.status != OrderStatus::FILLED &&
+            order.status != OrderStatus::CANCELLED &&
+            order.type == OrderType::LIMIT &&
+            order.filledQuantity < order.quantity) {
+            order.status = OrderStatus::PENDING;
+            orderBook.addOrder(order);
+        }
+    }
+
+    // Open quantity resting at prices the order crosses, including iceberg
+    // reserves, summed from the level aggregates (no individual orders are
+    // visited); stops once it covers the order. With self-trade prevention the
+    // order's own resting orders cannot fill it, so the orders are walked
+    // instead and the prevention mode applied to them: CANCEL_NEWEST stops at
+    // the first, CANCEL_OLDEST skips them, and DECREMENT_BOTH counts them
+    // because they take as much off the order as they would have filled.
+    double crossingQuantity(const Order& order, const Book& orderBook) const {
+        const bool isBuy = (order.side == OrderSide::BUY);
+        const double needed = order.quantity - order.filledQuantity;
+        double available = 0.0;
+        if (order.selfTradePrevention != SelfTradePrevention::NONE) {
+            orderBook.forEachOrder(isBuy ? OrderSide::SELL : OrderSide::BUY, kNoLimit,
+                                   [&](const Order& resting) {
+                if (order.type == OrderType::LIMIT &&
+                    (isBuy ? order.price < resting.price : order.price > resting.price)) {
+                    return false;
+                }
+                if (resting.traderKey == order.traderKey) {
+                    if (order.selfTradePrevention == SelfTradePrevention::CANCEL_NEWEST) {
+                        return false;
+                    }
+                    if (order.selfTradePrevention == SelfTradePrevention::CANCEL_OLDEST) {
+                        return true;
+                    }
+                }
+                available += resting.quantity - resting.filledQuantity;
+                return available < needed;
+            });
+            return available;
+        }
+        orderBook.forEachLevel(isBuy ? OrderSide::SELL : OrderSide::BUY, kNoLimit,
+                               [&](const LevelDepth& level) {
+            if (order.type == OrderType::LIMIT &&
+                (isBuy ? order.price < level.price : order.price > level.price)) {
+                return false;
+            }
+            available += level.quantity + level.hiddenQuantity;
+            return available < needed;
+        });
+        return available;
+    }
+
+    // Match an incoming order against the opposite side of the book
+    void matchAgainstBook(Order& order, Book& orderBook, std::vector<Trade>& trades) {
+        if (order.quantity <= 0 || order.filledQuantity >= order.quantity) {
+            return;
+        }
+
+        const bool isBuy = (order.side == OrderSide::BUY);
+        const OrderSide restingSide = isBuy ? OrderSide::SELL : OrderSide::BUY;
+        double remainingQuantity = order.quantity - order.filledQuantity;
+
+        // Walk the live opposite side from the best level until filled or no longer crossing
+        while (remainingQuantity > 0) {
+            const Order* resting = orderBook.bestOrder(restingSide);
+            if (!resting) break;
+
+            // For limit orders, check price
+            if (order.type == OrderType::LIMIT) {
+                if (isBuy ? order.price < resting->price : order.price > resting->price) {
+                    break; // No more matches possible
+                }
+            }
+
+            // Same trader on both sides: apply the incoming order's prevention mode
+            if (order.selfTradePrevention != SelfTradePrevention::NONE &&
+                resting->traderKey == order.traderKey) {
+                if (!preventSelfTrade(order, *resting, restingSide, orderBook)) {
+                    break;
+                }
+                remainingQuantity = order.quantity - order.filledQuantity;
+                continue;
+            }
+
+            // Only an iceberg's displayed slice is available; the book shows the
+            // next slice once it is used up
+            double availableQuantity = resting->visibleQuantity;
+            if (availableQuantity <= 0) {
+                // The book never leaves such an order at the front (filled
+                // orders leave, icebergs refill), but don't drop one unreported
+                cancelBestOrder(*resting, restingSide, orderBook);
+                continue;
+            }
+
+            // Determine match price (price-time priority)
+            Price matchPrice = (order.type == OrderType::MARKET) ?
+                               resting->price :
+                               std::min(order.price, resting->price);
+
+            double matchQuantity = std::min(remainingQuantity, availableQuantity);
+
+            // Create trade
+            trades.push_back(isBuy ? createTrade(order, *resting, matchPrice, matchQuantity)
+                                   : createTrade(*resting, order, matchPrice, matchQuantity));
+
+            // Update order quantities and status (the book updates the resting order)
+            order.filledQuantity += matchQuantity;
+            if (order.filledQuantity >= order.quantity) {
+                order.status = OrderStatus::FILLED;
+            } else {
+                order.status = OrderStatus::PARTIALLY_FILLED;
+            }
+            orderBook.fillBestOrder(restingSide, matchQuantity);
+            recordPrint(orderBook, matchPrice);
+
+            remainingQuantity -= matchQuantity;
+        }
+    }
+
+    // Resolve a would-be self-trade against the best resting order without
+    // trading. Returns false if the incoming order is done.
+    bool preventSelfTrade(Order& order, const Order& resting, OrderSide restingSide, Book& orderBook) {
+        if (order.selfTradePrevention == SelfTradePrevention::CANCEL_NEWEST) {
+            order.status = OrderStatus::CANCELLED;
+            return false;
+        }
+
+        double restingOpen = resting.quantity - resting.filledQuantity;
+        double decrement = restingOpen;
+        if (order.selfTradePrevention == SelfTradePrevention::DECREMENT_BOTH) {
+            decrement = std::min(order.quantity - order.filledQuantity, restingOpen);
+            order.quantity -= decrement;
+        }
+
+        if (decrement >= restingOpen) {
+            cancelBestOrder(resting, restingSide, orderBook);
+        } else {
+            OrderId restingId = resting.orderId;
+            orderBook.amendOrder(restingId, resting.price, resting.quantity - decrement);
+            engineAmends_.push_back(*orderBook.getOrder(restingId));
+        }
+
+        if (order.filledQuantity >= order.quantity) {
+            order.status = (order.filledQuantity > 0) ? OrderStatus::FILLED : OrderStatus::CANCELLED;
+            return false;
+        }
+        return true;
+    }
+
+    // Remove the best resting order of a side without trading, recording it for
+    // its owner to be told
+    void cancelBestOrder(const Order& resting, OrderSide restingSide, Book& orderBook) {
+        engineCancels_.push_back(resting);
+        engineCancels_.back().status = OrderStatus::CANCELLED;
+        orderBook.popBestOrder(restingSide);
+    }
+
+    // Create a trade from two orders
+    Trade createTrade(const Order& buyOrder, const Order& sellOrder,
+                      Price price, double quantity) {
+        Trade trade;
+        trade.tradeId = nextTradeId_;
+        nextTradeId_ += tradeIdStride_;
+        trade.buyOrderId = buyOrder.orderId;
+        trade.sellOrderId = sellOrder.orderId;
+        trade.buyTraderKey = buyOrder.traderKey;
+        trade.sellTraderKey = sellOrder.traderKey;
+        trade.symbol = buyOrder.symbol;
+        trade.price = price;
+        trade.quantity = quantity;
+        trade.timestamp = std::chrono::system_clock::now();
+        return trade;
+    }
+};
+
+#endif // BASIC_MATCHING_ENGINE_H
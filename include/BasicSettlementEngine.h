@@ -0,0 +1,85 @@
+#ifndef BASIC_SETTLEMENT_ENGINE_H
+#define BASIC_SETTLEMENT_ENGINE_H
+
+#include <string>
+#include <map>
+#include <memory>
+#include <vector>
+#include <iostream>
+#include <stdexcept>
+#include <utility>
+#include "Trade.h"
+#include "Account.h"
+
+// Listener that ignores every settlement
+struct NullSettlementListener {
+    void onSettlement(const std::string&, SymbolId, double, double, double) {}
+};
+
+// Settles trades between accounts, reporting each leg to a Listener whose
+// onSettlement(traderId, symbol, quantity, price, position) hook is resolved at
+// compile time; position is the trader's net position in symbol after the leg
+template <typename Listener>
+class BasicSettlementEngine {
+public:
+    explicit BasicSettlementEngine(Listener listener = Listener())
+        : listener_(std::move(listener)) {}
+
+    // Settle a trade (trade price is in ticks of tickSize)
+    void settleTrade(const Trade& trade,
+                     std::shared_ptr<Account> buyAccount,
+                     std::shared_ptr<Account> sellAccount,
+                     double tickSize) {
+        if (!buyAccount || !sellAccount) {
+            throw std::invalid_argument("Accounts cannot be null");
+        }
+
+        double price = ticksToPrice(trade.price, tickSize);
+        double totalCost = price * trade.quantity;
+
+        // Buyer pays money and receives shares
+        if (!buyAccount->withdraw(totalCost)) {
+            // Insufficient funds - don't settle, but don't throw
+            // The trade should not have been executed if funds were insufficient
+            // This is a safety check
+            std::cerr << "Warning: Buyer account has insufficient funds for trade "
+                      << formatTradeId(trade.tradeId) << std::endl;
+            return;
+        }
+        double buyPosition = buyAccount->updatePosition(trade.symbol, trade.quantity);
+
+        // Seller receives money and gives shares
+        sellAccount->deposit(totalCost);
+        double sellPosition = sellAccount->updatePosition(trade.symbol, -trade.quantity);
+
+        // Notify about settlement
+        const TraderRegistry& traders = TraderRegistry::instance();
+        listener_.onSettlement(traders.getTraderId(trade.buyTraderKey), trade.symbol, trade.quantity,
+                               price, buyPosition);
+        listener_.onSettlement(traders.getTraderId(trade.sellTraderKey), trade.symbol, -trade.quantity,
+                               price, sellPosition);
+    }
+
+    // Settle multiple trades, with accounts keyed by interned trader ID
+    void settleTrades(const std::vector<Trade>& trades,
+                      const std::map<TraderKey, std::shared_ptr<Account>>& accounts,
+                      double tickSize) {
+        for (const auto& trade : trades) {
+            auto buyAccountIt = accounts.find(trade.buyTraderKey);
+            auto sellAccountIt = accounts.find(trade.sellTraderKey);
+
+            if (buyAccountIt == accounts.end() || sellAccountIt == accounts.end()) {
+                continue; // Skip if accounts not found
+            }
+
+            settleTrade(trade, buyAccountIt->second, sellAccountIt->second, tickSize);
+        }
+    }
+
+    Listener& getListener() { return listener_; }
+
+private:
+    Listener listener_;
+};
+
+#endif // BASIC_SETTLEMENT_ENGINE_H
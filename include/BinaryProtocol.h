@@ -0,0 +1,204 @@
+#ifndef BINARY_PROTOCOL_H
+#define BINARY_PROTOCOL_H
+
+#include <string>
+#include <string_view>
+#include <cstring>
+#include <cstdint>
+#include <cstddef>
+#include <type_traits>
+#include <algorithm>
+
+// Fixed-layout binary order entry, chosen per session with
+// "REGISTER:traderId:BINARY". After the REGISTERED reply every message in
+// both directions is one of the structs below, sent as-is: little-endian,
+// naturally aligned, no padding the compiler could vary. Each starts with a
+// header whose length is the size of the whole message, so a receiver decodes
+// with a length check and a memcpy. Prices are in ticks of the symbol's tick
+// size; symbols are ASCII, NUL-padded to 8 bytes.
+
+static_assert(__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__,
+              "Binary messages are sent in host byte order, which must be little-endian");
+
+enum class BinaryMessageType : uint8_t {
+    // Client to server
+    NEW_ORDER = 1,
+    CANCEL = 2,
+    REPLACE = 3,
+    // Server to client
+    ACK = 64,         // Order accepted and queued
+    REJECT = 65,      // Order, cancel or replace refused
+    FILL = 66,        // One side of a trade
+    ORDER_DONE = 67,  // Order left the book without filling completely
+    REPLACED = 68     // Replace applied
+};
+
+// Why an order, cancel or replace was refused; an order gets the same reason
+// a text session would see in ORDER_REJECTED (INVALID_ORDER if none applies)
+enum class BinaryRejectReason : uint8_t {
+    INVALID_ORDER = 1,
+    UNKNOWN_ORDER = 2,
+    INVALID_REPLACE = 3,
+    MALFORMED = 4,
+    UNKNOWN_SYMBOL = 5,
+    INVALID_SIDE = 6,
+    INVALID_TYPE = 7,
+    INVALID_PRICE = 8,
+    INVALID_QUANTITY = 9,
+    INVALID_FIELD = 10,
+    INCONSISTENT_FIELDS = 11,
+    UNKNOWN_TRADER = 12,
+    UNAVAILABLE = 13
+};
+
+enum class BinaryDoneReason : uint8_t {
+    CANCELLED = 0,
+    EXPIRED = 1
+};
+
+constexpr size_t kBinarySymbolLength = 8;
+
+struct BinaryHeader {
+    uint16_t length;          // Bytes in the whole message, header included
+    BinaryMessageType type;
+    uint8_t reserved;
+};
+
+struct BinaryNewOrder {
+    static constexpr BinaryMessageType kType = BinaryMessageType::NEW_ORDER;
+    BinaryHeader header;
+    uint8_t side;                  // OrderSide
+    uint8_t orderType;             // OrderType
+    uint8_t timeInForce;           // TimeInForce
+    uint8_t selfTradePrevention;   // SelfTradePrevention
+    char symbol[kBinarySymbolLength];
+    uint64_t clientOrderId;
+    int64_t price;                 // Ticks; 0 for market and stop orders
+    int64_t stopPrice;             // Ticks; stop orders only
+    double quantity;
+    double displayQuantity;        // Iceberg slice; 0 = whole order
+    uint64_t expireTime;           // GTD only, milliseconds since the Unix epoch
+};
+
+struct BinaryCancel {
+    static constexpr BinaryMessageType kType = BinaryMessageType::CANCEL;
+    BinaryHeader header;
+    uint32_t reserved;
+    char symbol[kBinarySymbolLength];
+    uint64_t orderId;
+};
+
+struct BinaryReplace {
+    static constexpr BinaryMessageType kType = BinaryMessageType::REPLACE;
+    BinaryHeader header;
+    uint32_t reserved;
+    char symbol[kBinarySymbolLength];
+    uint64_t orderId;
+    int64_t price;                 // Ticks
+    double quantity;               // New total, including what has filled
+};
+
+struct BinaryAck {
+    static constexpr BinaryMessageType kType = BinaryMessageType::ACK;
+    BinaryHeader header;
+    uint32_t reserved;
+    uint64_t orderId;
+    uint64_t clientOrderId;
+};
+
+struct BinaryReject {
+    static constexpr BinaryMessageType kType = BinaryMessageType::REJECT;
+    BinaryHeader header;
+    BinaryRejectReason reason;
+    uint8_t reserved[3];
+    uint64_t orderId;              // Server order ID (0 if none was assigned)
+    uint64_t clientOrderId;
+};
+
+struct BinaryFill {
+    static constexpr BinaryMessageType kType = BinaryMessageType::FILL;
+    BinaryHeader header;
+    uint8_t side;                  // OrderSide of the receiving trader
+    uint8_t reserved[3];
+    uint64_t tradeId;
+    uint64_t orderId;
+    char symbol[kBinarySymbolLength];
+    int64_t price;                 // Ticks
+    double quantity;
+};
+
+struct BinaryOrderDone {
+    static constexpr BinaryMessageType kType = BinaryMessageType::ORDER_DONE;
+    BinaryHeader header;
+    BinaryDoneReason reason;
+    uint8_t reserved[3];
+    uint64_t orderId;
+    uint64_t clientOrderId;
+    double filledQuantity;
+};
+
+struct BinaryReplaced {
+    static constexpr BinaryMessageType kType = BinaryMessageType::REPLACED;
+    BinaryHeader header;
+    uint32_t reserved;
+    uint64_t orderId;
+    uint64_t clientOrderId;
+    int64_t price;                 // Ticks
+    double quantity;
+};
+
+static_assert(sizeof(BinaryHeader) == 4, "BinaryHeader layout");
+static_assert(sizeof(BinaryNewOrder) == 64, "BinaryNewOrder layout");
+static_assert(sizeof(BinaryCancel) == 24, "BinaryCancel layout");
+static_assert(sizeof(BinaryReplace) == 40, "BinaryReplace layout");
+static_assert(sizeof(BinaryAck) == 24, "BinaryAck layout");
+static_assert(sizeof(BinaryReject) == 24, "BinaryReject layout");
+static_assert(sizeof(BinaryFill) == 48, "BinaryFill layout");
+static_assert(sizeof(BinaryOrderDone) == 32, "BinaryOrderDone layout");
+static_assert(sizeof(BinaryReplaced) == 40, "BinaryReplaced layout");
+
+// Largest message either side sends
+constexpr size_t kMaxBinaryMessageSize = 64;
+
+// A zeroed message with its header filled in
+template <typename Message>
+Message makeBinaryMessage() {
+    static_assert(std::is_trivially_copyable<Message>::value, "Binary messages are raw bytes");
+    Message message;
+    std::memset(&message, 0, sizeof(message));
+    message.header.length = static_cast<uint16_t>(sizeof(Message));
+    message.header.type = Message::kType;
+    return message;
+}
+
+// Decode one framed message: a length check and a memcpy
+template <typename Message>
+bool decodeBinaryMessage(std::string_view frame, Message& message) {
+    if (frame.size() != sizeof(Message)) {
+        return false;
+    }
+    std::memcpy(&message, frame.data(), sizeof(Message));
+    return message.header.type == Message::kType;
+}
+
+// Append a message's bytes to an outbound buffer
+template <typename Message>
+void appendBinaryMessage(std::string& out, const Message& message) {
+    out.append(reinterpret_cast<const char*>(&message), sizeof(Message));
+}
+
+// Symbol field <-> name
+inline std::string_view binarySymbol(const char (&symbol)[kBinarySymbolLength]) {
+    size_t length = 0;
+    while (length < kBinarySymbolLength && symbol[length] != '\0') {
+        ++length;
+    }
+    return std::string_view(symbol, length);
+}
+
+inline void setBinarySymbol(char (&symbol)[kBinarySymbolLength], std::string_view name) {
+    std::memset(symbol, 0, kBinarySymbolLength);
+    std::memcpy(symbol, name.data(), std::min(name.size(), kBinarySymbolLength));
+}
+
+#endif // BINARY_PROTOCOL_H
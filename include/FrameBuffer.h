@@ -0,0 +1,108 @@
+#ifndef FRAME_BUFFER_H
+#define FRAME_BUFFER_H
+
+#include <vector>
+#include <string_view>
+#include <cstring>
+#include <cstddef>
+#include <cstdint>
+#include <algorithm>
+
+// Longest partial message a session may hold before it is dropped
+constexpr size_t kMaxFrameSize = 65536;
+
+// Per-session inbound byte buffer that reassembles newline-delimited (text) or
+// length-prefixed (binary) frames across reads. The socket is read straight
+// into the free space at the back (prepare/commit); complete frames are handed
+// out as views into the buffer and the unconsumed tail is moved to the front
+// only when space runs out, so each byte is copied at most once more after the
+// read.
+class FrameBuffer {
+public:
+    explicit FrameBuffer(size_t maxFrameSize = kMaxFrameSize)
+        : data_(4096), begin_(0), end_(0), scanned_(0), maxFrameSize_(maxFrameSize) {}
+
+    // Writable space of at least minSpace bytes after the buffered data
+    char* prepare(size_t minSpace) {
+        if (data_.size() - end_ < minSpace) {
+            compact();
+            if (data_.size() - end_ < minSpace) {
+                data_.resize(end_ + minSpace);
+            }
+        }
+        return data_.data() + end_;
+    }
+
+    // Mark length bytes written at prepare() as buffered
+    void commit(size_t length) { end_ += length; }
+
+    // Next complete frame, without its '\n' (or "\r\n"); false if only a
+    // partial frame (or nothing) is buffered. The view stays valid until the
+    // next prepare() or compact().
+    bool nextLine(std::string_view& line) {
+        const char* start = data_.data() + begin_;
+        const char* scanFrom = data_.data() + scanned_;
+        const void* newline = std::memchr(scanFrom, '\n', end_ - scanned_);
+        if (!newline) {
+            scanned_ = end_; // Don't rescan a long partial frame on every read
+            return false;
+        }
+        size_t length = static_cast<const char*>(newline) - start;
+        begin_ += length + 1;
+        scanned_ = begin_;
+        if (length > 0 && start[length - 1] == '\r') {
+            --length;
+        }
+        line = std::string_view(start, length);
+        return true;
+    }
+
+    // Next complete length-prefixed frame: the first two bytes (little-endian)
+    // give the length of the whole frame, prefix included. A length below 2
+    // yields just the prefix, for the caller to reject. False if incomplete.
+    bool nextFrame(std::string_view& frame) {
+        if (readable() < sizeof(uint16_t)) {
+            return false;
+        }
+        const char* start = data_.data() + begin_;
+        uint16_t length;
+        std::memcpy(&length, start, sizeof(length));
+        length = std::max<uint16_t>(length, sizeof(uint16_t));
+        if (readable() < length) {
+            return false;
+        }
+        begin_ += length;
+        scanned_ = begin_;
+        frame = std::string_view(start, length);
+        return true;
+    }
+
+    // Bytes buffered but not yet consumed
+    size_t readable() const { return end_ - begin_; }
+
+    // Whether the buffered partial frame has outgrown the frame size limit
+    bool overflowed() const { return readable() > maxFrameSize_; }
+
+    // Move unconsumed bytes to the front of the buffer
+    void compact() {
+        if (begin_ == 0) {
+            return;
+        }
+        size_t remaining = end_ - begin_;
+        if (remaining > 0) {
+            std::memmove(data_.data(), data_.data() + begin_, remaining);
+        }
+        scanned_ -= begin_;
+        begin_ = 0;
+        end_ = remaining;
+    }
+
+private:
+    std::vector<char> data_;
+    size_t begin_;    // First unconsumed byte
+    size_t end_;      // One past the last buffered byte
+    size_t scanned_;  // Bytes before this hold no '\n'
+    size_t maxFrameSize_;
+};
+
+#endif // FRAME_BUFFER_H
@@ -2,7 +2,9 @@
 #define MARKET_SERVER_H
 
 #include <string>
+#include <string_view>
 #include <map>
+#include <set>
 #include <vector>
 #include <memory>
 #include <thread>
@@ -10,6 +12,9 @@
 #include <atomic>
 #include "OrderBook.h"
 #include "MatchingEngine.h"
+#include "MatchingShard.h"
+#include "SessionReactor.h"
+#include "BinaryProtocol.h"
 #include "SettlementEngine.h"
 #include "Trader.h"
 #include "Account.h"
@@ -18,7 +23,9 @@
 
 class MarketServer {
 public:
-    MarketServer(int port = 8888);
+    // matchingThreads == 0 picks one per core, up to kMaxDefaultMatchingThreads;
+    // sessionThreads == 0 likewise, up to kMaxDefaultSessionThreads
+    MarketServer(int port = 8888, size_t matchingThreads = 0, size_t sessionThreads = 0);
     ~MarketServer();
     
     // Start the server
@@ -30,12 +37,60 @@ public:
     // Register a trader with an account
     void registerTrader(std::shared_ptr<Trader> trader, std::shared_ptr<Account> account);
     
+    // Let a trader's sessions drive call auctions with AUCTION messages;
+    // sessions of other traders have them refused
+    void addOperator(const std::string& traderId);
+    
     // Get or create order book for a symbol
     OrderBook& getOrderBook(const std::string& symbol);
+    OrderBook& getOrderBook(SymbolId symbol);
+    
+    // Set the tick size for a symbol (must be called before its order book is created)
+    void setTickSize(const std::string& symbol, double tickSize);
+    
+    // Get the tick size for a symbol (kDefaultTickSize unless configured)
+    double getTickSize(const std::string& symbol) const;
+    double getTickSize(SymbolId symbol) const;
     
-    // Submit an order
+    // Select the book backend for a symbol (must be called before its order book is created)
+    void setBookMode(const std::string& symbol, BookMode mode);
+    
+    // Validate an order and hand it to the matching thread that owns its
+    // symbol. Returns once the order is queued; matching happens asynchronously.
     bool submitOrder(const Order& order);
     
+    // Submit a batch of orders (e.g. every order in one client packet) with a
+    // single trader lookup. Orders that fail validation are marked REJECTED;
+    // returns the number accepted.
+    size_t submitOrders(Order* orders, size_t count);
+    
+    // Call auctions: startAuction switches a symbol to the call phase, where
+    // orders accumulate without matching; uncrossAuction executes everything
+    // that crosses at the single volume-maximizing price and stays in the call
+    // phase; endAuction uncrosses and resumes continuous matching. All three
+    // run asynchronously on the symbol's matching thread.
+    bool startAuction(const std::string& symbol);
+    bool uncrossAuction(const std::string& symbol);
+    bool endAuction(const std::string& symbol);
+    
+    // Cancel a resting (or untriggered stop) order, or replace its price and
+    // total quantity. Both run asynchronously on the symbol's matching thread,
+    // which checks that traderId owns the order and reports the outcome to it.
+    // A replace that only reduces quantity keeps the order's time priority.
+    bool cancelOrder(const std::string& traderId, const std::string& symbol, OrderId orderId);
+    bool replaceOrder(const std::string& traderId, const std::string& symbol, OrderId orderId,
+                      double price, double quantity);
+    
+    // Number of matching threads symbols are sharded across
+    size_t getMatchingThreadCount() const { return shards_.size(); }
+    
+    // Number of reactor threads client sessions are spread across
+    size_t getSessionThreadCount() const { return reactors_.size(); }
+    
+    // How sessions that fall more than maxOutboundBytes behind on their
+    // outbound messages are treated (default: disconnect past kDefaultMaxOutboundBytes)
+    void setSlowConsumerPolicy(SlowConsumerPolicy policy, size_t maxOutboundBytes = kDefaultMaxOutboundBytes);
+    
     // Get trader by ID
     std::shared_ptr<Trader> getTrader(const std::string& traderId);
     
@@ -50,12 +105,50 @@ private:
     int serverSocket_;
     std::atomic<bool> running_;
     
-    std::map<std::string, std::shared_ptr<OrderBook>> orderBooks_;
+    // Order ID sequencer: monotonic, seeded from the clock at startup so IDs
+    // stay unique across restarts
+    std::atomic<OrderId> nextOrderId_;
+    
+    // Order books indexed by SymbolId. A slot is published once and never
+    // replaced, so the order path finds its book without taking a lock.
+    std::unique_ptr<std::atomic<OrderBook*>[]> orderBooks_;
+    std::vector<std::unique_ptr<OrderBook>> ownedOrderBooks_; // guarded by orderBooksMutex_
+    std::vector<std::vector<OrderBook*>> shardOrderBooks_;     // per shard; guarded by orderBooksMutex_
+    
+    // Latest published snapshot of each book, indexed by SymbolId (read and
+    // replaced with std::atomic_load/atomic_store); whether the book has changed
+    // since its last snapshot and since its orders were last copied (both only
+    // touched by the symbol's matching thread); and whether a reader has asked
+    // for its orders since
+    std::unique_ptr<std::shared_ptr<const OrderBookSnapshot>[]> snapshots_;
+    std::unique_ptr<bool[]> snapshotStale_;
+    std::unique_ptr<bool[]> ordersStale_;
+    std::unique_ptr<std::atomic<bool>[]> ordersWanted_;
+    
+    // Per-symbol book configuration, applied when the order book is created
+    struct SymbolConfig {
+        double tickSize = kDefaultTickSize;
+        BookMode bookMode = BookMode::TREE;
+    };
+    std::map<SymbolId, SymbolConfig> symbolConfigs_;
     std::map<std::string, std::shared_ptr<Trader>> traders_;
     std::map<std::string, std::shared_ptr<Account>> accounts_;
-    std::map<std::string, int> traderSockets_; // traderId -> socket
+    std::set<std::string> operators_; // Trader IDs allowed to send AUCTION; guarded by tradersMutex_
+    // A registered trader's session outbox and the wire format it chose
+    struct TraderConnection {
+        std::shared_ptr<SessionOutbox> outbox;
+        Session::Protocol protocol = Session::Protocol::TEXT;
+    };
+    std::map<std::string, TraderConnection> traderSockets_; // traderId -> connection
     
-    MatchingEngine matchingEngine_;
+    // Matching threads; a symbol is owned by shards_[symbol % shards_.size()],
+    // which is the only thread that modifies its order book
+    std::vector<std::unique_ptr<MatchingShard>> shards_;
+    
+    // Session reactors: each polls its share of the client sockets on one
+    // thread; connections are assigned round-robin by the accept thread
+    std::vector<std::unique_ptr<SessionReactor>> reactors_;
+    size_t nextReactor_;
     SettlementEngine settlementEngine_;
     OrderLogger orderLogger_;
     
@@ -68,21 +161,101 @@ private:
     
     // Socket handling
     void acceptConnections();
-    void handleClient(int clientSocket);
-    void processMessage(int clientSocket, const std::string& message);
     
-    // Message parsing
-    Order parseOrderMessage(const std::string& message, const std::string& traderId);
+    // Consume the complete messages buffered for a session (reactor thread);
+    // returns false to close it
+    bool handleSessionData(Session& session);
+    // "REGISTER:traderId[:BINARY]"; returns false if the request is malformed
+    bool registerSession(Session& session, const std::string& request);
+    void onSessionClosed(Session& session);
+    
+    // Handle one message line; well-formed orders are appended to orderBatch
+    // and submitted together by processOrderBatch
+    void processMessage(Session& session, std::string_view message, std::vector<Order>& orderBatch);
+    void processOrderBatch(Session& session, std::vector<Order>& orderBatch);
+    void sendOrderAcks(Session& session, const std::vector<Order>& orderBatch);
+    
+    // Handle one binary message; new orders are appended to orderBatch.
+    // Returns false if the frame cannot be a message at all.
+    bool processBinaryMessage(Session& session, std::string_view frame,
+                              std::vector<Order>& orderBatch);
+    Order decodeBinaryOrder(const BinaryNewOrder& message, const std::string& traderId);
+    void sendBinaryReject(Session& session, BinaryRejectReason reason, OrderId orderId,
+                          uint64_t clientOrderId);
+    
+    // Match, settle, log and report a run of orders for one symbol; runs on the
+    // matching thread that owns the symbol
+    void executeOrders(Order* orders, size_t count, MatchingEngine& matchingEngine,
+                       std::vector<Trade>& trades);
+    
+    // Apply a control request (auction phase changes, cancels and replaces);
+    // runs on the matching thread
+    void executeControl(const ShardRequest& request, MatchingEngine& matchingEngine,
+                        std::vector<Trade>& trades);
+    
+    // Expire due GTD orders in every book a shard owns; runs on its matching thread
+    void expireOrders(size_t shardIndex);
+    
+    // Publish a new snapshot of every book of a shard that changed since its
+    // last one, copying its orders too if a reader asked for them; runs on the
+    // matching thread between batches
+    void publishSnapshots(size_t shardIndex);
+    
+    // Note that a book changed; called on its matching thread
+    void markSnapshotStale(SymbolId symbol);
+    
+    // Report, log and settle trades from one book
+    void processTrades(const std::vector<Trade>& trades, double tickSize);
+    
+    // Mark orders that fail the server-side checks (unknown symbol or trader)
+    // REJECTED with the reason; submitOrders and processOrderBatch run it
+    // before queuing
+    void validateOrders(Order* orders, size_t count);
+    
+    // Queue a request on the matching thread that owns request.order.symbol
+    bool enqueueRequest(ShardRequest&& request);
+    bool enqueueOrder(const Order& order);
+    bool enqueueControl(const std::string& symbol, ShardRequestType type);
+    
+    // Cancel and replace by symbol ID and tick price, shared by both protocols
+    bool enqueueCancel(const std::string& traderId, SymbolId symbol, OrderId orderId);
+    bool enqueueReplace(const std::string& traderId, SymbolId symbol, OrderId orderId,
+                        Price price, double quantity);
+    
+    // Create the order book for a symbol; caller must hold orderBooksMutex_
+    OrderBook& createOrderBook(SymbolId symbol);
+    
+    // Message formatting
     std::string createResponseMessage(const std::string& status, const std::string& data);
     
     // Trade callback
     void onTradeExecuted(const Trade& trade);
     
+    // Notify the owner that an order was cancelled (with what it had filled)
+    void onOrderCancelled(const Order& order);
+    
+    // Notify the owner that an order now stands at a new price and total quantity
+    void onOrderReplaced(const Order& order, double tickSize);
+    
+    // Notify owners of orders the engine cancelled or shrank on its own during
+    // its last call (self-trade prevention and the like)
+    void reportEngineActions(const MatchingEngine& matchingEngine);
+    
+    // Notify the owner that a GTD order expired (with what it had filled)
+    void onOrderExpired(const Order& order);
+    
+    // Queue a message for a trader's session, if connected: text sessions get
+    // the text form, binary sessions the binary form (or nothing, if empty).
+    // conflationKey is passed on to SessionOutbox::send.
+    void notifyTrader(const std::string& traderId, std::string message,
+                      std::string binaryMessage = std::string(), uint64_t conflationKey = 0);
+    
     // Settlement callback
     void onSettlementComplete(const std::string& traderId, 
-                             const std::string& symbol,
+                             SymbolId symbol,
                              double quantity, 
-                             double price);
+                             double price,
+                             double position);
     
     // Get all orderbook symbols (for web interface)
     std::vector<std::string> getOrderBookSymbols() const;
@@ -93,6 +266,14 @@ private:
     // Get number of traders with active orders (for web interface)
     int getTradersWithActiveOrdersCount() const;
     
+    // Latest published snapshot of a symbol's book, empty if it has none yet;
+    // nullptr for a symbol that was never registered. withOrders asks the
+    // matching thread to copy the book's orders into its next snapshot; the
+    // orders returned are from the previous such request, if any. Safe from
+    // any thread (for web interface).
+    std::shared_ptr<const OrderBookSnapshot> getOrderBookSnapshot(const std::string& symbol,
+                                                                  bool withOrders = false) const;
+    
     // Friend class for web server access
     friend class WebServer;
 };
@@ -1,44 +1,37 @@
 #ifndef MATCHING_ENGINE_H
 #define MATCHING_ENGINE_H
 
-#include <string>
-#include <map>
-#include <vector>
-#include <memory>
 #include <functional>
+#include <cstdint>
+#include "BasicMatchingEngine.h"
 #include "OrderBook.h"
 #include "Trade.h"
 
-class MatchingEngine {
+// Listener that forwards trades to a callback set at runtime
+struct CallbackTradeListener {
+    std::function<void(const Trade&)> callback;
+
+    void onTrade(const Trade& trade) {
+        if (callback) {
+            callback(trade);
+        }
+    }
+};
+
+// Compiled once, in MatchingEngine.cpp
+extern template class BasicMatchingEngine<OrderBook, CallbackTradeListener>;
+
+// Matching engine over OrderBook that reports trades through a runtime callback
+class MatchingEngine : public BasicMatchingEngine<OrderBook, CallbackTradeListener> {
 public:
     using TradeCallback = std::function<void(const Trade&)>;
-    
-    MatchingEngine();
-    
-    // Submit an order for matching
-    std::vector<Trade> submitOrder(Order& order, OrderBook& orderBook);
-    
+
+    // Trade IDs are generated as firstTradeId, firstTradeId + tradeIdStride, ...
+    explicit MatchingEngine(uint64_t firstTradeId = 0, uint64_t tradeIdStride = 1)
+        : BasicMatchingEngine(firstTradeId, tradeIdStride) {}
+
     // Set callback for trade notifications
-    void setTradeCallback(TradeCallback callback) { tradeCallback_ = callback; }
-    
-private:
-    TradeCallback tradeCallback_;
-    
-    // Match a buy order against sell orders
-    std::vector<Trade> matchBuyOrder(Order& buyOrder, OrderBook& orderBook);
-    
-    // Match a sell order against buy orders
-    std::vector<Trade> matchSellOrder(Order& sellOrder, OrderBook& orderBook);
-    
-    // Create a trade from two orders
-    Trade createTrade(const Order& buyOrder, const Order& sellOrder, 
-                      double price, double quantity);
-    
-    // Generate unique trade ID
-    std::string generateTradeId();
-    
-    int tradeIdCounter_;
+    void setTradeCallback(TradeCallback callback) { getListener().callback = std::move(callback); }
 };
 
 #endif // MATCHING_ENGINE_H
-
@@ -0,0 +1,103 @@
+#ifndef MATCHING_SHARD_H
+#define MATCHING_SHARD_H
+
+#include <thread>
+#include <chrono>
+#include <atomic>
+#include <functional>
+#include <vector>
+#include <cstddef>
+#include "MatchingEngine.h"
+#include "MpscQueue.h"
+#include "Trade.h"
+
+constexpr size_t kDefaultShardQueueCapacity = 65536;
+
+// Requests the worker drains from its queue per pass
+constexpr size_t kMaxShardBatch = 64;
+
+// Minimum time between maintenance passes (order expiry) on a worker
+constexpr auto kShardMaintenanceInterval = std::chrono::milliseconds(1);
+
+// Work handed to a matching worker. Everything that modifies a book goes
+// through its shard's queue so that the worker stays the only writer.
+enum class ShardRequestType {
+    ORDER,          // Match (or rest) order
+    START_AUCTION,  // Switch order.symbol to the call phase
+    UNCROSS,        // Uncross order.symbol, staying in the call phase
+    END_AUCTION,    // Uncross order.symbol and resume continuous matching
+    CANCEL,         // Cancel order.orderId on behalf of order.traderId
+    REPLACE         // Replace order.orderId with order.price and order.quantity
+};
+
+struct ShardRequest {
+    ShardRequestType type = ShardRequestType::ORDER;
+    Order order; // The order, or for control requests its symbol (and target)
+};
+
+// A matching worker: one thread that owns a subset of the symbols and is the
+// only writer of their order books. Sessions hand requests over through a
+// lock-free MPSC queue; the worker drains them in batches and runs each run of
+// consecutive orders for the same symbol through its own MatchingEngine.
+class MatchingShard {
+public:
+    // Called on the worker thread for each run of dequeued orders that share a
+    // symbol; trades is an empty buffer reused across calls
+    using OrderHandler = std::function<void(Order* orders, size_t count, MatchingEngine& engine,
+                                            std::vector<Trade>& trades)>;
+
+    // Called on the worker thread for each control request, in queue order
+    using ControlHandler = std::function<void(const ShardRequest& request, MatchingEngine& engine,
+                                              std::vector<Trade>& trades)>;
+
+    // Called on the worker thread between batches, at most once per
+    // kShardMaintenanceInterval, with the shard's index
+    using MaintenanceHandler = std::function<void(size_t shardIndex)>;
+
+    // Trade IDs are drawn from shardIndex, shardIndex + shardCount, ... so that
+    // shards never hand out the same ID
+    MatchingShard(size_t shardIndex, size_t shardCount, OrderHandler orderHandler,
+                  ControlHandler controlHandler, MaintenanceHandler maintenanceHandler = nullptr,
+                  size_t queueCapacity = kDefaultShardQueueCapacity);
+    ~MatchingShard();
+
+    MatchingShard(const MatchingShard&) = delete;
+    MatchingShard& operator=(const MatchingShard&) = delete;
+
+    MatchingEngine& getMatchingEngine() { return matchingEngine_; }
+
+    // Start the worker thread
+    void start();
+
+    // Stop the worker thread after it has drained the queue
+    void stop();
+
+    bool isRunning() const { return running_; }
+
+    // Hand a request to the worker; safe from any thread. Returns false if the
+    // queue is full.
+    bool tryEnqueue(ShardRequest&& request) { return queue_.tryPush(std::move(request)); }
+
+private:
+    MpscQueue<ShardRequest> queue_;
+    size_t shardIndex_;
+    MatchingEngine matchingEngine_;
+    OrderHandler orderHandler_;
+    ControlHandler controlHandler_;
+    MaintenanceHandler maintenanceHandler_;
+    std::chrono::steady_clock::time_point nextMaintenance_;
+    std::atomic<bool> running_;
+
+    // Worker-thread buffers, reused for every batch
+    std::vector<ShardRequest> batch_;
+    std::vector<Order> orders_;
+    std::vector<Trade> trades_;
+    std::thread thread_;
+
+    void run();
+    size_t drainBatch();
+    void dispatchBatch(size_t count);
+    void maintain();
+};
+
+#endif // MATCHING_SHARD_H
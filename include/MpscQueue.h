@@ -0,0 +1,84 @@
+#ifndef MPSC_QUEUE_H
+#define MPSC_QUEUE_H
+
+#include <atomic>
+#include <memory>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+
+// Bounded lock-free multi-producer / single-consumer queue.
+// Each cell carries a sequence number that tells producers whether it is
+// free and the consumer whether it has been published, so producers only
+// contend on one CAS of the tail and the consumer never writes shared
+// counters. Capacity is rounded up to a power of two.
+template <typename T>
+class MpscQueue {
+public:
+    explicit MpscQueue(size_t capacity)
+        : head_(0), tail_(0) {
+        size_t size = 2;
+        while (size < capacity) size *= 2;
+        mask_ = size - 1;
+        cells_.reset(new Cell[size]);
+        for (size_t i = 0; i < size; ++i) {
+            cells_[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    MpscQueue(const MpscQueue&) = delete;
+    MpscQueue& operator=(const MpscQueue&) = delete;
+
+    // Enqueue a value; safe from any thread. Returns false if the queue is full.
+    bool tryPush(T&& value) {
+        Cell* cell;
+        size_t pos = tail_.load(std::memory_order_relaxed);
+        while (true) {
+            cell = &cells_[pos & mask_];
+            size_t sequence = cell->sequence.load(std::memory_order_acquire);
+            intptr_t diff = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(pos);
+            if (diff == 0) {
+                if (tail_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    break;
+                }
+            } else if (diff < 0) {
+                return false;
+            } else {
+                pos = tail_.load(std::memory_order_relaxed);
+            }
+        }
+        cell->value = std::move(value);
+        cell->sequence.store(pos + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Dequeue a value; consumer thread only. Returns false if the queue is empty.
+    bool tryPop(T& value) {
+        Cell& cell = cells_[head_ & mask_];
+        size_t sequence = cell.sequence.load(std::memory_order_acquire);
+        if (static_cast<intptr_t>(sequence) - static_cast<intptr_t>(head_ + 1) < 0) {
+            return false;
+        }
+        value = std::move(cell.value);
+        cell.sequence.store(head_ + mask_ + 1, std::memory_order_release);
+        ++head_;
+        return true;
+    }
+
+    size_t capacity() const { return mask_ + 1; }
+
+private:
+    struct Cell {
+        std::atomic<size_t> sequence;
+        T value;
+    };
+
+    std::unique_ptr<Cell[]> cells_;
+    size_t mask_;
+
+    // Consumer and producer positions live on separate cache lines
+    alignas(64) size_t head_;
+    alignas(64) std::atomic<size_t> tail_;
+};
+
+#endif // MPSC_QUEUE_H
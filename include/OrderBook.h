@@ -5,50 +5,286 @@
 #include <map>
 #include <vector>
 #include <memory>
+#include <cstdint>
+#include <memory_resource>
+#include <cstddef>
+#include <functional>
 #include "Trade.h"
+#include "PriceLevels.h"
+#include "SlabPool.h"
+#include "TimerWheel.h"
+
+// Aggregate view of one price level
+struct LevelDepth {
+    Price price;        // In ticks
+    double quantity;    // Total displayed open quantity
+    uint32_t orderCount;
+    double hiddenQuantity; // Iceberg reserve behind the displayed quantity (not market data)
+};
+
+// Matching regime of a book
+enum class TradingPhase {
+    CONTINUOUS,   // Orders match on arrival, price-time priority
+    CALL_AUCTION  // Orders accumulate (the book may cross) until the next uncross
+};
+
+// Result of a hypothetical uncross: the single price that maximizes executed
+// volume, with the smaller side's leftover at that price. volume is 0 when
+// the book is not crossed.
+struct AuctionQuote {
+    Price price;      // In ticks
+    double volume;
+    double surplus;
+};
+
+// Levels a book snapshot keeps per side
+constexpr size_t kSnapshotDepth = 10;
+
+// Copy of a book's resting orders; costs a pass over the whole book, so it is
+// only taken when a reader asks for it
+struct RestingOrdersSnapshot {
+    std::vector<Order> buyOrders;        // Priority order
+    std::vector<Order> sellOrders;
+};
+
+// Copy of a book's quotes and top levels for readers off its matching thread
+// (the web interface); taken by the matching thread and never modified afterwards
+struct OrderBookSnapshot {
+    std::string symbol;
+    double tickSize = kDefaultTickSize;
+    TradingPhase phase = TradingPhase::CONTINUOUS;
+    Price bestBid = 0;                   // In ticks, 0 if none
+    Price bestAsk = 0;
+    AuctionQuote indicativeUncross = {}; // Only meaningful in the call phase
+    std::vector<LevelDepth> bids;        // Best price first, up to the depth taken
+    std::vector<LevelDepth> asks;
+    std::shared_ptr<const RestingOrdersSnapshot> orders; // As of the last request; may be nullptr
+};
+
+// Pass as a visitor limit to visit everything
+constexpr size_t kNoLimit = SIZE_MAX;
+
+// Compact, stable handle to a resting order record (slot in the book's slab pool)
+using OrderHandle = uint32_t;
+constexpr OrderHandle kInvalidOrderHandle = UINT32_MAX;
 
 class OrderBook {
 public:
-    OrderBook(const std::string& symbol);
-    
+    OrderBook(const std::string& symbol, double tickSize = kDefaultTickSize,
+              BookMode mode = BookMode::TREE);
+
     const std::string& getSymbol() const { return symbol_; }
+    SymbolId getSymbolId() const { return symbolId_; }
+    double getTickSize() const { return tickSize_; }
+    BookMode getMode() const { return buyLevels_.getMode(); }
     
+    TradingPhase getTradingPhase() const { return phase_; }
+    void setTradingPhase(TradingPhase phase) { phase_ = phase; }
+
     // Add order to the book
     void addOrder(const Order& order);
-    
-    // Remove order from the book
-    bool removeOrder(const std::string& orderId);
-    
+
+    // Remove order (resting or untriggered stop) from the book
+    bool removeOrder(OrderId orderId);
+
+    // Amend a resting order to a new price and total quantity (which must
+    // exceed what has already filled). Reducing the quantity at the same price
+    // keeps time priority; a price change or size increase moves the order to
+    // the back of the target level. Either way the order keeps its record and
+    // index entry. Does not match: the caller must not amend into a cross.
+    bool amendOrder(OrderId orderId, Price price, double quantity);
+
+    // Get best bid (highest buy price) in ticks, 0 if none
+    Price getBestBidTicks() const;
+
+    // Get best ask (lowest sell price) in ticks, 0 if none
+    Price getBestAskTicks() const;
+
     // Get best bid (highest buy price)
-    double getBestBid() const;
-    
+    double getBestBid() const { return ticksToPrice(getBestBidTicks(), tickSize_); }
+
     // Get best ask (lowest sell price)
-    double getBestAsk() const;
-    
+    double getBestAsk() const { return ticksToPrice(getBestAskTicks(), tickSize_); }
+
+    // Visit up to maxLevels price levels of a side, best price first, without
+    // copying anything. fn(const LevelDepth&) returns false to stop early.
+    template <typename Fn>
+    void forEachLevel(OrderSide side, size_t maxLevels, Fn&& fn) const;
+
+    // Visit up to maxOrders resting orders of a side in priority order (price,
+    // then time). fn(const Order&) returns false to stop early. The book must
+    // not be modified during the visit.
+    template <typename Fn>
+    void forEachOrder(OrderSide side, size_t maxOrders, Fn&& fn) const;
+
     // Get all buy orders sorted by price (descending)
     std::vector<Order> getBuyOrders() const;
-    
+
     // Get all sell orders sorted by price (ascending)
     std::vector<Order> getSellOrders() const;
-    
-    // Get order by ID
-    Order* getOrder(const std::string& orderId);
-    
+
+    // Get the best nLevels price levels of a side with their displayed open
+    // quantity and order count, best price first. Reads the level aggregates;
+    // copies no orders.
+    std::vector<LevelDepth> getDepth(OrderSide side, size_t nLevels) const;
+
+    // Copy the book's quotes and its best depth levels per side (no orders);
+    // must run on the book's writer thread
+    OrderBookSnapshot takeSnapshot(size_t depth = kSnapshotDepth) const;
+
+    // Copy every resting order; must run on the book's writer thread
+    RestingOrdersSnapshot takeOrdersSnapshot() const;
+
+    // Compute the uncross price from the level aggregates: maximum executable
+    // volume, then minimum surplus, then the middle of any remaining tie
+    AuctionQuote getIndicativeUncross() const;
+
+    // Hold a STOP or STOP_LIMIT order until a trade triggers it
+    void addStopOrder(const Order& order);
+
+    // Number of untriggered stop orders
+    size_t getStopOrderCount() const { return buyStops_.size() + sellStops_.size(); }
+
+    // Price of the last trade in ticks, 0 if none; set by the matching engine
+    Price getLastTradePrice() const { return lastTradePrice_; }
+    void setLastTradePrice(Price price) { lastTradePrice_ = price; }
+
+    // Move every stop that trades printed between low and high (in ticks) have
+    // triggered (buy stops at or below high, sell stops at or above low) to the
+    // end of out, in stop price then arrival order. O(log n + k) for k
+    // triggered stops.
+    void popTriggeredStops(Price low, Price high, std::vector<Order>& out);
+
+    // Remove every GTD order (resting or stop) whose expireTime is at or
+    // before now (milliseconds since the Unix epoch), appending them to
+    // expired. Expiries are kept in a timing wheel, so this costs O(1) per
+    // elapsed tick plus O(1) per expiring order.
+    size_t expireOrders(uint64_t now, std::vector<Order>& expired);
+
+    // Number of scheduled expiries, including ones whose order has since left the book
+    size_t getPendingExpiryCount() const { return expiryWheel_.size(); }
+
+    // Get order (resting or untriggered stop) by ID
+    const Order* getOrder(OrderId orderId) const;
+
+    // Matching cursor: the oldest order at the best price on a side, or nullptr
+    // if that side is empty. The order is live; it stays valid until the book changes.
+    const Order* bestOrder(OrderSide side) const;
+
+    // Fill quantity (at most its visibleQuantity) against the order returned by
+    // bestOrder(side), updating its status and the level totals. The order is
+    // removed once fully filled; an iceberg whose slice is used up gets a new
+    // slice from its reserve and moves to the back of its level.
+    void fillBestOrder(OrderSide side, double quantity);
+
+    // Remove the order currently returned by bestOrder(side)
+    void popBestOrder(OrderSide side);
+
+    // Number of orders resting in the book
+    size_t getOrderCount() const { return indexedOrders_; }
+
+    // Number of allocations the book has made for its own storage (slabs,
+    // level nodes, index). Stays flat once the book has warmed up.
+    size_t getAllocationCount() const { return allocationCounter_.getAllocationCount(); }
+
 private:
+    // Slab-allocated order record, linked into the FIFO queue of its price level
+    struct OrderNode {
+        Order order;
+        OrderHandle prev = kInvalidOrderHandle;
+        OrderHandle next = kInvalidOrderHandle;
+    };
+
+    // Price level: intrusive doubly-linked FIFO of order nodes (oldest at head),
+    // with running totals maintained on add, fill and cancel
+    struct PriceLevel {
+        OrderHandle head = kInvalidOrderHandle;
+        OrderHandle tail = kInvalidOrderHandle;
+        double totalQuantity = 0.0;  // Displayed open quantity
+        double hiddenQuantity = 0.0; // Open quantity held back by icebergs
+        uint32_t orderCount = 0;
+    };
+
     std::string symbol_;
-    
-    // Buy orders: price -> vector of orders (sorted by time)
-    std::map<double, std::vector<Order>, std::greater<double>> buyOrders_;
-    
-    // Sell orders: price -> vector of orders (sorted by time)
-    std::map<double, std::vector<Order>> sellOrders_;
-    
-    // Quick lookup: orderId -> iterator
-    std::map<std::string, std::pair<double, size_t>> orderIndex_;
-    
-    void indexOrder(const std::string& orderId, double price, size_t position, OrderSide side);
-    void removeFromIndex(const std::string& orderId);
+    SymbolId symbolId_;
+    double tickSize_;
+    TradingPhase phase_;
+
+    // All book storage is drawn from memoryPool_, which recycles freed blocks
+    // and goes to allocationCounter_ only when it needs more memory
+    AllocationCounter allocationCounter_;
+    std::pmr::unsynchronized_pool_resource memoryPool_;
+
+    // Buy levels: price -> FIFO queue (highest price first)
+    PriceLevels<PriceLevel> buyLevels_;
+
+    // Sell levels: price -> FIFO queue (lowest price first)
+    PriceLevels<PriceLevel> sellLevels_;
+
+    // Untriggered stops keyed by stop price, nearest to triggering first
+    // (equal keys keep arrival order)
+    std::pmr::multimap<Price, Order> buyStops_;
+    std::pmr::multimap<Price, Order, std::greater<Price>> sellStops_;
+    Price lastTradePrice_;
+
+    // GTD expiries by orderId; an entry is dropped when it fires if its order
+    // has left the book (or changed expiry) in the meantime
+    TimerWheel expiryWheel_;
+
+    // Order records; released slots are recycled
+    SlabPool<OrderNode> nodes_;
+
+    // Quick lookup: open-addressing table of node handles hashed by orderId
+    // (kInvalidOrderHandle marks an empty slot); keys live in the nodes themselves
+    std::pmr::vector<OrderHandle> orderIndex_;
+    size_t indexedOrders_;
+
+    OrderHandle allocateNode(const Order& order);
+    void releaseNode(OrderHandle handle);
+    OrderHandle findHandle(OrderId orderId) const;
+    void indexOrder(OrderHandle handle);
+    void unindexOrder(OrderHandle handle);
+    void growIndex();
+    void linkBack(PriceLevel& level, OrderHandle handle);
+    void unlink(PriceLevel& level, OrderHandle handle);
+
+    const PriceLevels<PriceLevel>& levelsFor(OrderSide side) const {
+        return (side == OrderSide::BUY) ? buyLevels_ : sellLevels_;
+    }
+
+    bool removeFromLevels(PriceLevels<PriceLevel>& levels, OrderHandle handle);
+    bool removeStopOrder(OrderId orderId);
 };
 
-#endif // ORDERBOOK_H
+template <typename Fn>
+void OrderBook::forEachLevel(OrderSide side, size_t maxLevels, Fn&& fn) const {
+    if (maxLevels == 0) {
+        return;
+    }
+    size_t visited = 0;
+    levelsFor(side).forEach([&](Price price, const PriceLevel& level) {
+        if (!fn(LevelDepth{price, level.totalQuantity, level.orderCount, level.hiddenQuantity})) {
+            return false;
+        }
+        return ++visited < maxLevels;
+    });
+}
 
+template <typename Fn>
+void OrderBook::forEachOrder(OrderSide side, size_t maxOrders, Fn&& fn) const {
+    if (maxOrders == 0) {
+        return;
+    }
+    size_t visited = 0;
+    levelsFor(side).forEach([&](Price, const PriceLevel& level) {
+        for (OrderHandle handle = level.head; handle != kInvalidOrderHandle;
+             handle = nodes_[handle].next) {
+            if (!fn(nodes_[handle].order) || ++visited >= maxOrders) {
+                return false;
+            }
+        }
+        return true;
+    });
+}
+
+#endif // ORDERBOOK_H
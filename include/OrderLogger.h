@@ -4,34 +4,76 @@
 #include <string>
 #include <memory>
 #include <mutex>
+#include <thread>
+#include <atomic>
+#include <vector>
+#include <chrono>
+#include <cstddef>
 #include "Trade.h"
+#include "MpscQueue.h"
 
+// Records waiting for the writer thread; past this, new records are dropped
+constexpr size_t kLogQueueCapacity = 16384;
+
+// Most records the writer thread commits in one transaction
+constexpr size_t kMaxLogBatch = 256;
+
+// How long the writer thread sleeps when there is nothing to write
+constexpr auto kLogIdleSleep = std::chrono::milliseconds(1);
+
+// Logs orders and trades to PostgreSQL without blocking the caller: records
+// are copied into a lock-free queue and a writer thread inserts them in
+// batches, one transaction per batch
 class OrderLogger {
 public:
     // PostgreSQL connection string format: "host=localhost port=5432 dbname=market user=postgres password=postgres"
     OrderLogger(const std::string& connectionString = "host=localhost port=5432 dbname=market user=postgres password=postgres");
     ~OrderLogger();
     
-    // Initialize database (create tables)
+    // Initialize database (create tables) and start the writer thread
     bool initialize();
     
-    // Log an order submission
-    bool logOrder(const Order& order);
+    // Queue an order submission for logging (prices are converted from ticks
+    // of tickSize). Safe from any thread; returns false if the logger is not
+    // connected or its queue is full.
+    bool logOrder(const Order& order, double tickSize);
+    
+    // Queue a trade execution for logging, likewise
+    bool logTrade(const Trade& trade, double tickSize);
     
-    // Log a trade execution
-    bool logTrade(const Trade& trade);
+    // Records dropped because the writer thread fell behind
+    size_t getDroppedCount() const { return dropped_; }
     
-    // Close database connection
+    // Write what is queued, stop the writer thread and close the database connection
     void close();
 
 private:
+    // One queued order or trade
+    struct LogRecord {
+        bool isTrade = false;
+        Order order;
+        Trade trade;
+        double tickSize = kDefaultTickSize;
+    };
+    
     std::string connectionString_;
     void* conn_; // PGconn* (using void* to avoid including libpq-fe.h in header)
     mutable std::mutex connMutex_; // Protect connection from concurrent access
     
+    std::unique_ptr<MpscQueue<LogRecord>> queue_; // Created once connected
+    std::atomic<bool> running_;
+    std::atomic<size_t> dropped_;
+    std::thread writerThread_;
+    
+    bool enqueue(LogRecord&& record);
+    void runWriter();
+    // Insert records in one transaction; caller must hold connMutex_
+    void writeBatch(const std::vector<LogRecord>& records);
+    // Insert one record; caller must hold connMutex_
+    bool writeOrder(const Order& order, double tickSize);
+    bool writeTrade(const Trade& trade, double tickSize);
     bool executeQuery(const std::string& query);
     std::string escapeString(const std::string& str);
 };
 
 #endif // ORDER_LOGGER_H
-
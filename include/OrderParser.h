@@ -0,0 +1,48 @@
+#ifndef ORDER_PARSER_H
+#define ORDER_PARSER_H
+
+#include <string_view>
+#include <functional>
+#include "Trade.h"
+
+// Tick size of a symbol, used to convert text prices to ticks
+using TickSizeLookup = std::function<double(SymbolId)>;
+
+// Parse a text order,
+//   "ORDER:traderId:symbol:side:type:price:quantity[:KEY=VALUE...]",
+// into order in a single pass over the message: fields are views into it and
+// numbers are read with std::from_chars, so nothing is copied except the
+// trader ID and symbol handed to their registries. Fills the trader, symbol
+// and order fields; the order ID and timestamp are left to the caller.
+// Returns NONE, or the first problem found (also stored in order.rejectReason
+// with status REJECTED). Parsing continues past a bad field so that a CLID is
+// still picked up for the rejection.
+OrderRejectReason parseOrderMessage(std::string_view message, Order& order,
+                                    const TickSizeLookup& tickSizeOf);
+
+// A text cancel or replace request
+struct CancelReplaceRequest {
+    bool isCancel = false;
+    std::string_view traderId;         // View into the message
+    SymbolId symbol = kInvalidSymbolId;
+    OrderId orderId = 0;
+    Price price = 0;                   // Replace only, in ticks of the symbol
+    double quantity = 0;               // Replace only
+};
+
+// Parse "CANCEL:traderId:symbol:orderId" or
+// "REPLACE:traderId:symbol:orderId:price:quantity" the same single-pass way,
+// holding the new price and quantity to the rules of a limit order. Returns
+// NONE or the first problem: MALFORMED (prefix, field count or order ID),
+// UNKNOWN_SYMBOL (one no order has registered), INVALID_PRICE or
+// INVALID_QUANTITY.
+OrderRejectReason parseCancelReplaceMessage(std::string_view message, CancelReplaceRequest& request,
+                                            const TickSizeLookup& tickSizeOf);
+
+// Field rules every order must meet whatever protocol it came in on: GTD
+// orders need an expiry still in the future and other orders must not have
+// one; likewise stop orders and a stop price; only limit orders may show an
+// iceberg display quantity
+bool hasConsistentOrderFields(const Order& order);
+
+#endif // ORDER_PARSER_H
@@ -0,0 +1,30 @@
+#ifndef PRICE_H
+#define PRICE_H
+
+#include <cstdint>
+#include <cmath>
+
+// Prices are fixed-point integers counted in ticks of the symbol's tick size.
+// Conversion to and from decimal prices happens only at the protocol, JSON and
+// database edges.
+using Price = int64_t;
+
+constexpr double kDefaultTickSize = 0.01;
+
+// Convert a decimal price to ticks. Returns false if the price is not on the tick grid.
+inline bool priceToTicks(double price, double tickSize, Price& ticks) {
+    double scaled = price / tickSize;
+    double rounded = std::round(scaled);
+    if (std::fabs(scaled - rounded) > 1e-6) {
+        return false;
+    }
+    ticks = static_cast<Price>(rounded);
+    return true;
+}
+
+// Convert ticks back to a decimal price
+inline double ticksToPrice(Price ticks, double tickSize) {
+    return static_cast<double>(ticks) * tickSize;
+}
+
+#endif // PRICE_H
@@ -0,0 +1,295 @@
+#ifndef PRICE_LEVELS_H
+#define PRICE_LEVELS_H
+
+#include <map>
+#include <vector>
+#include <memory_resource>
+#include <algorithm>
+#include <utility>
+#include <cstdint>
+#include <cstddef>
+#include <limits>
+#include "Price.h"
+
+// Storage backend for the price levels of an order book
+enum class BookMode {
+    TREE,   // Red-black tree keyed by price; any price range
+    LADDER  // Dense array indexed by tick offset from a movable base; bounded-range symbols
+};
+
+constexpr size_t kDefaultLadderLevels = 1024;
+
+// Largest a ladder may grow; levels that would need a wider window go to the tree
+constexpr size_t kMaxLadderLevels = size_t(1) << 16;
+
+// Price levels of one side of an order book, iterated best price first.
+// In LADDER mode levels live in a contiguous array indexed by (price - base)
+// with a bitmap of non-empty levels; the base moves (and the array grows, up
+// to kMaxLadderLevels) when an order arrives outside the current window.
+// A price too far from the resting levels to fit that window gets its level
+// in the tree instead, so a stray order cannot blow up the array. All storage
+// comes from the memory resource supplied by the owning book.
+template <typename Level>
+class PriceLevels {
+public:
+    PriceLevels(bool descending, BookMode mode, std::pmr::memory_resource* resource,
+                size_t ladderLevels = kDefaultLadderLevels)
+        : descending_(descending), mode_(mode), tree_(resource), ladder_(resource),
+          occupied_(resource), base_(0), count_(0), bestIndex_(0) {
+        if (mode_ == BookMode::LADDER) {
+            size_t size = 64;
+            while (size < std::min(ladderLevels, kMaxLadderLevels)) size *= 2;
+            ladder_.resize(size);
+            occupied_.resize(size / 64, 0);
+        }
+    }
+
+    BookMode getMode() const { return mode_; }
+
+    bool empty() const {
+        return count_ == 0 && tree_.empty();
+    }
+
+    size_t levelCount() const {
+        return count_ + tree_.size();
+    }
+
+    // Get the level at a price, creating an empty one if needed
+    Level& getOrCreate(Price price) {
+        if (mode_ == BookMode::TREE) {
+            return tree_[price];
+        }
+        if (!tree_.empty()) {
+            auto it = tree_.find(price);
+            if (it != tree_.end()) {
+                return it->second;
+            }
+        }
+        if ((count_ == 0 || !inWindow(price)) && !rebase(price)) {
+            return tree_[price];
+        }
+        size_t index = static_cast<size_t>(price - base_);
+        if (!isOccupied(index)) {
+            setOccupied(index);
+            if (count_ == 0 || isBetter(index, bestIndex_)) {
+                bestIndex_ = index;
+            }
+            ++count_;
+        }
+        return ladder_[index];
+    }
+
+    // Get the level at a price, or nullptr if there is none
+    Level* find(Price price) {
+        if (mode_ == BookMode::TREE) {
+            auto it = tree_.find(price);
+            return it != tree_.end() ? &it->second : nullptr;
+        }
+        if (count_ > 0 && inWindow(price)) {
+            size_t index = static_cast<size_t>(price - base_);
+            if (isOccupied(index)) {
+                return &ladder_[index];
+            }
+        }
+        if (tree_.empty()) {
+            return nullptr;
+        }
+        auto it = tree_.find(price);
+        return it != tree_.end() ? &it->second : nullptr;
+    }
+
+    // Remove the level at a price
+    void erase(Price price) {
+        if (mode_ == BookMode::TREE) {
+            tree_.erase(price);
+            return;
+        }
+        size_t index = (count_ > 0 && inWindow(price)) ? static_cast<size_t>(price - base_) : kNone;
+        if (index == kNone || !isOccupied(index)) {
+            tree_.erase(price);
+            return;
+        }
+        ladder_[index] = Level();
+        clearOccupied(index);
+        --count_;
+        if (count_ > 0 && index == bestIndex_) {
+            bestIndex_ = descending_ ? findPrevOccupied(index) : findNextOccupied(index);
+        }
+    }
+
+    // Best price on this side; requires !empty()
+    Price bestPrice() const {
+        if (count_ == 0) {
+            return descending_ ? tree_.rbegin()->first : tree_.begin()->first;
+        }
+        Price best = base_ + static_cast<Price>(bestIndex_);
+        if (!tree_.empty()) {
+            Price treeBest = descending_ ? tree_.rbegin()->first : tree_.begin()->first;
+            if (isBetterPrice(treeBest, best)) {
+                return treeBest;
+            }
+        }
+        return best;
+    }
+
+    // Best level on this side, or nullptr if empty
+    Level* bestLevel() {
+        return const_cast<Level*>(static_cast<const PriceLevels*>(this)->bestLevel());
+    }
+
+    const Level* bestLevel() const {
+        if (empty()) {
+            return nullptr;
+        }
+        if (count_ == 0) {
+            return descending_ ? &tree_.rbegin()->second : &tree_.begin()->second;
+        }
+        if (!tree_.empty()) {
+            const auto& treeBest = descending_ ? *tree_.rbegin() : *tree_.begin();
+            if (isBetterPrice(treeBest.first, base_ + static_cast<Price>(bestIndex_))) {
+                return &treeBest.second;
+            }
+        }
+        return &ladder_[bestIndex_];
+    }
+
+    // Visit levels best price first; fn(Price, const Level&) returns false to stop
+    template <typename Fn>
+    void forEach(Fn&& fn) const {
+        if (descending_) {
+            forEachMerged(tree_.rbegin(), tree_.rend(), fn);
+        } else {
+            forEachMerged(tree_.begin(), tree_.end(), fn);
+        }
+    }
+
+private:
+    static constexpr size_t kNone = SIZE_MAX;
+
+    bool descending_;
+    BookMode mode_;
+
+    // TREE mode; in LADDER mode, the levels that did not fit the window
+    std::pmr::map<Price, Level> tree_;
+
+    // LADDER mode
+    std::pmr::vector<Level> ladder_;
+    std::pmr::vector<uint64_t> occupied_; // Bit i set when ladder_[i] holds orders
+    Price base_;                     // Price of ladder_[0]
+    size_t count_;                   // Number of non-empty levels
+    size_t bestIndex_;               // Index of the best non-empty level
+
+    bool isBetter(size_t a, size_t b) const { return descending_ ? a > b : a < b; }
+    bool isBetterPrice(Price a, Price b) const { return descending_ ? a > b : a < b; }
+
+    // Whether price falls in the ladder window (unsigned difference: no overflow)
+    bool inWindow(Price price) const {
+        return price >= base_ &&
+               static_cast<uint64_t>(price) - static_cast<uint64_t>(base_) < ladder_.size();
+    }
+
+    // Whether a window of size levels starting at base stays within Price
+    static bool fitsWindow(Price base, size_t size) {
+        return base <= std::numeric_limits<Price>::max() - static_cast<Price>(size);
+    }
+
+    // Walk ladder levels and the tree levels in [it, end) together, best price first
+    template <typename It, typename Fn>
+    void forEachMerged(It it, It end, Fn& fn) const {
+        size_t index = count_ > 0 ? bestIndex_ : kNone;
+        size_t visited = 0;
+        while (index != kNone || it != end) {
+            if (index != kNone &&
+                (it == end || isBetterPrice(base_ + static_cast<Price>(index), it->first))) {
+                if (!fn(base_ + static_cast<Price>(index), ladder_[index])) return;
+                index = (++visited < count_)
+                    ? (descending_ ? findPrevOccupied(index) : findNextOccupied(index))
+                    : kNone;
+            } else {
+                if (!fn(it->first, it->second)) return;
+                ++it;
+            }
+        }
+    }
+
+    bool isOccupied(size_t index) const {
+        return (occupied_[index >> 6] >> (index & 63)) & 1;
+    }
+    void setOccupied(size_t index) { occupied_[index >> 6] |= (uint64_t(1) << (index & 63)); }
+    void clearOccupied(size_t index) { occupied_[index >> 6] &= ~(uint64_t(1) << (index & 63)); }
+
+    // Next non-empty level strictly above index, or kNone
+    size_t findNextOccupied(size_t index) const {
+        ++index;
+        if (index >= ladder_.size()) return kNone;
+        size_t word = index >> 6;
+        uint64_t bits = occupied_[word] & (~uint64_t(0) << (index & 63));
+        while (true) {
+            if (bits) return (word << 6) + static_cast<size_t>(__builtin_ctzll(bits));
+            if (++word >= occupied_.size()) return kNone;
+            bits = occupied_[word];
+        }
+    }
+
+    // Next non-empty level strictly below index, or kNone
+    size_t findPrevOccupied(size_t index) const {
+        if (index == 0) return kNone;
+        --index;
+        size_t word = index >> 6;
+        uint64_t bits = occupied_[word] & (~uint64_t(0) >> (63 - (index & 63)));
+        while (true) {
+            if (bits) return (word << 6) + 63 - static_cast<size_t>(__builtin_clzll(bits));
+            if (word == 0) return kNone;
+            bits = occupied_[--word];
+        }
+    }
+
+    // Move the window (growing it if needed) so that price fits, keeping
+    // existing levels. False, leaving the ladder as it was, if that would take
+    // more than kMaxLadderLevels.
+    bool rebase(Price price) {
+        size_t size = ladder_.size();
+        if (count_ == 0) {
+            Price newBase;
+            if (__builtin_sub_overflow(price, static_cast<Price>(size / 2), &newBase) ||
+                !fitsWindow(newBase, size)) {
+                return false;
+            }
+            base_ = newBase;
+            return true;
+        }
+
+        size_t lowIndex = isOccupied(0) ? 0 : findNextOccupied(0);
+        size_t highIndex = isOccupied(size - 1) ? size - 1 : findPrevOccupied(size - 1);
+        Price low = std::min(price, base_ + static_cast<Price>(lowIndex));
+        Price high = std::max(price, base_ + static_cast<Price>(highIndex));
+        uint64_t distance = static_cast<uint64_t>(high) - static_cast<uint64_t>(low);
+        if (distance >= kMaxLadderLevels / 2) {
+            return false;
+        }
+        size_t span = static_cast<size_t>(distance) + 1;
+
+        size_t newSize = size;
+        while (newSize < span * 2) newSize *= 2;
+        Price newBase;
+        if (__builtin_sub_overflow(low, static_cast<Price>((newSize - span) / 2), &newBase) ||
+            !fitsWindow(newBase, newSize)) {
+            return false;
+        }
+
+        std::pmr::vector<Level> ladder(newSize, ladder_.get_allocator());
+        std::pmr::vector<uint64_t> occupied(newSize / 64, 0, occupied_.get_allocator());
+        for (size_t index = lowIndex; index != kNone && index <= highIndex; index = findNextOccupied(index)) {
+            size_t newIndex = static_cast<size_t>(base_ + static_cast<Price>(index) - newBase);
+            ladder[newIndex] = std::move(ladder_[index]);
+            occupied[newIndex >> 6] |= (uint64_t(1) << (newIndex & 63));
+        }
+        bestIndex_ = static_cast<size_t>(base_ + static_cast<Price>(bestIndex_) - newBase);
+        ladder_.swap(ladder);
+        occupied_.swap(occupied);
+        base_ = newBase;
+        return true;
+    }
+};
+
+#endif // PRICE_LEVELS_H
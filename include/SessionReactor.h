@@ -0,0 +1,167 @@
+#ifndef SESSION_REACTOR_H
+#define SESSION_REACTOR_H
+
+#include <string>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+#include <deque>
+#include <cstddef>
+#include <cstdint>
+#include "FrameBuffer.h"
+
+class SessionReactor;
+
+// What happens to messages for a session whose outbound backlog has reached
+// the reactor's limit (the peer is not reading fast enough)
+enum class SlowConsumerPolicy {
+    DISCONNECT,  // Close the session
+    DROP,        // Discard new messages until the backlog drains
+    CONFLATE     // Replace the queued message with the same conflation key (e.g. the
+                 // previous settlement for a symbol); close the session if the new
+                 // message has no key
+};
+
+constexpr size_t kDefaultMaxOutboundBytes = 1 << 20;
+
+// Messages waiting to be written to one session. Queued from any thread; the
+// session's reactor writes everything queued with one writev per wakeup, so a
+// burst of acks, fills and settlements costs one syscall rather than one each,
+// and no sender ever blocks on the socket.
+class SessionOutbox : public std::enable_shared_from_this<SessionOutbox> {
+public:
+    SessionOutbox(SessionReactor& reactor, int socket) : reactor_(reactor), socket_(socket) {}
+
+    // Queue a message. conflationKey (non-zero) marks messages that may
+    // replace an earlier one with the same key under SlowConsumerPolicy::CONFLATE.
+    // Returns false if the session is closed or the message was refused.
+    bool send(std::string message, uint64_t conflationKey = 0);
+
+    // Messages refused because of the slow-consumer policy
+    size_t getDroppedCount() const;
+
+private:
+    friend class SessionReactor;
+
+    // Refuse further messages and discard the queue (reactor thread)
+    void close();
+
+    SessionReactor& reactor_;
+    const int socket_;
+
+    mutable std::mutex mutex_;
+    std::vector<std::string> pending_;      // Queued since the reactor last took them
+    std::vector<uint64_t> pendingKeys_;     // Conflation key of each pending message
+    size_t pendingBytes_ = 0;
+    size_t writingBytes_ = 0;               // Taken by the reactor but not yet written
+    size_t dropped_ = 0;
+    bool flushScheduled_ = false;
+    bool overflowed_ = false;               // Reactor should close the session
+    bool closed_ = false;
+
+    // Reactor thread only
+    std::deque<std::string> writing_;
+    size_t writeOffset_ = 0;                // Bytes of writing_.front() already written
+    bool awaitingWritable_ = false;         // EPOLLOUT is armed
+};
+
+// Connection state for one client socket, owned by the reactor that polls it
+struct Session {
+    enum class State {
+        AWAITING_REGISTER,  // Connected; the first message must be REGISTER
+        ACTIVE              // Registered as traderId
+    };
+
+    // Wire format, chosen at registration
+    enum class Protocol {
+        TEXT,    // Newline-delimited text messages
+        BINARY   // Fixed-layout binary messages (BinaryProtocol.h)
+    };
+
+    int socket = -1;
+    State state = State::AWAITING_REGISTER;
+    Protocol protocol = Protocol::TEXT;
+    std::string traderId;
+    FrameBuffer inbound; // Bytes read but not yet consumed as messages
+    std::shared_ptr<SessionOutbox> outbox; // Messages to the client; may outlive the session
+};
+
+// An epoll event loop on one thread serving any number of non-blocking
+// client sockets. Sessions are handed over with addSession (from any thread);
+// afterwards only the reactor thread touches them, except through their
+// outbox.
+class SessionReactor {
+public:
+    // Called on the reactor thread after each read into session.inbound, to
+    // consume the complete messages it now holds; returning false closes the session
+    using DataHandler = std::function<bool(Session& session)>;
+
+    // Called on the reactor thread just before a session's socket is closed
+    using CloseHandler = std::function<void(Session& session)>;
+
+    SessionReactor(DataHandler dataHandler, CloseHandler closeHandler);
+    ~SessionReactor();
+
+    SessionReactor(const SessionReactor&) = delete;
+    SessionReactor& operator=(const SessionReactor&) = delete;
+
+    // Start the reactor thread
+    void start();
+
+    // Stop the reactor thread and close every session
+    void stop();
+
+    // Make socket non-blocking and start serving it; safe from any thread.
+    // Returns false (and closes the socket) if it cannot be polled.
+    bool addSession(int socket);
+
+    // Number of open sessions
+    size_t getSessionCount() const;
+
+    // How sessions whose outbound backlog exceeds maxOutboundBytes are treated
+    void setSlowConsumerPolicy(SlowConsumerPolicy policy, size_t maxOutboundBytes);
+
+private:
+    DataHandler dataHandler_;
+    CloseHandler closeHandler_;
+    int epollFd_;
+    int wakeFd_; // eventfd that interrupts epoll_wait on stop
+    std::atomic<bool> running_;
+    std::thread thread_;
+
+    // Sessions by socket; inserted by addSession, erased on the reactor thread
+    mutable std::mutex sessionsMutex_;
+    std::unordered_map<int, std::unique_ptr<Session>> sessions_;
+
+    std::atomic<SlowConsumerPolicy> slowConsumerPolicy_;
+    std::atomic<size_t> maxOutboundBytes_;
+
+    // Outboxes with messages to write, flushed after each round of events
+    std::mutex flushMutex_;
+    std::vector<std::shared_ptr<SessionOutbox>> flushQueue_;
+    std::vector<std::shared_ptr<SessionOutbox>> flushing_; // Reactor thread only
+
+    friend class SessionOutbox;
+
+    void run();
+
+    // Read everything available; returns false when the session should close
+    bool readSession(Session& session);
+    void closeSession(Session& session);
+
+    // Queue an outbox for the next flush, waking the reactor if called from
+    // another thread
+    void scheduleFlush(std::shared_ptr<SessionOutbox> outbox);
+    void flushScheduled();
+
+    // Write as much of the outbox as the socket takes; returns false when the
+    // session should close
+    bool flush(SessionOutbox& outbox);
+    void setWritableInterest(SessionOutbox& outbox, bool enabled);
+};
+
+#endif // SESSION_REACTOR_H
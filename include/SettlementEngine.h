@@ -2,38 +2,38 @@
 #define SETTLEMENT_ENGINE_H
 
 #include <string>
-#include <map>
-#include <memory>
 #include <functional>
-#include "Trade.h"
-#include "Account.h"
+#include "BasicSettlementEngine.h"
 
-class SettlementEngine {
+// Listener that forwards settlements to a callback set at runtime
+struct CallbackSettlementListener {
+    std::function<void(const std::string& traderId, SymbolId symbol,
+                       double quantity, double price, double position)> callback;
+
+    void onSettlement(const std::string& traderId, SymbolId symbol, double quantity, double price,
+                      double position) {
+        if (callback) {
+            callback(traderId, symbol, quantity, price, position);
+        }
+    }
+};
+
+// Compiled once, in SettlementEngine.cpp
+extern template class BasicSettlementEngine<CallbackSettlementListener>;
+
+// Settlement engine that reports settlements through a runtime callback
+class SettlementEngine : public BasicSettlementEngine<CallbackSettlementListener> {
 public:
     using SettlementCallback = std::function<void(const std::string& traderId, 
-                                                   const std::string& symbol,
+                                                   SymbolId symbol,
                                                    double quantity, 
-                                                   double price)>;
-    
-    SettlementEngine();
-    
-    // Settle a trade
-    void settleTrade(const Trade& trade, 
-                     std::shared_ptr<Account> buyAccount,
-                     std::shared_ptr<Account> sellAccount);
-    
-    // Settle multiple trades
-    void settleTrades(const std::vector<Trade>& trades,
-                     const std::map<std::string, std::shared_ptr<Account>>& accounts);
+                                                   double price,
+                                                   double position)>;
     
     // Set callback for settlement notifications
     void setSettlementCallback(SettlementCallback callback) { 
-        settlementCallback_ = callback; 
+        getListener().callback = std::move(callback); 
     }
-    
-private:
-    SettlementCallback settlementCallback_;
 };
 
 #endif // SETTLEMENT_ENGINE_H
-
@@ -0,0 +1,101 @@
+#ifndef SLAB_POOL_H
+#define SLAB_POOL_H
+
+#include <memory_resource>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include <new>
+
+// Memory resource that counts every allocation it forwards upstream.
+// Order books route all of their internal storage through one of these so
+// that steady-state allocation behaviour can be observed.
+class AllocationCounter : public std::pmr::memory_resource {
+public:
+    explicit AllocationCounter(std::pmr::memory_resource* upstream = std::pmr::new_delete_resource())
+        : upstream_(upstream), allocations_(0) {}
+
+    size_t getAllocationCount() const { return allocations_; }
+
+private:
+    std::pmr::memory_resource* upstream_;
+    size_t allocations_;
+
+    void* do_allocate(size_t bytes, size_t alignment) override {
+        ++allocations_;
+        return upstream_->allocate(bytes, alignment);
+    }
+
+    void do_deallocate(void* p, size_t bytes, size_t alignment) override {
+        upstream_->deallocate(p, bytes, alignment);
+    }
+
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override {
+        return this == &other;
+    }
+};
+
+// Slab allocator for fixed-type records addressed by compact integer handles.
+// Records are allocated SlabSize at a time and never move, so handles and
+// pointers stay valid. Released slots are recycled without destroying the
+// record, which lets members such as strings keep their capacity.
+template <typename T, size_t SlabSize = 1024>
+class SlabPool {
+public:
+    explicit SlabPool(std::pmr::memory_resource* resource)
+        : resource_(resource), slabs_(resource), freeSlots_(resource) {}
+
+    ~SlabPool() {
+        for (T* slab : slabs_) {
+            for (size_t i = 0; i < SlabSize; ++i) {
+                slab[i].~T();
+            }
+            resource_->deallocate(slab, sizeof(T) * SlabSize, alignof(T));
+        }
+    }
+
+    SlabPool(const SlabPool&) = delete;
+    SlabPool& operator=(const SlabPool&) = delete;
+
+    // Take a free slot, adding a slab if none is left
+    uint32_t allocate() {
+        if (freeSlots_.empty()) {
+            addSlab();
+        }
+        uint32_t handle = freeSlots_.back();
+        freeSlots_.pop_back();
+        return handle;
+    }
+
+    // Return a slot to the free list; the record is kept for reuse
+    void release(uint32_t handle) {
+        freeSlots_.push_back(handle);
+    }
+
+    T& operator[](uint32_t handle) { return slabs_[handle / SlabSize][handle % SlabSize]; }
+    const T& operator[](uint32_t handle) const { return slabs_[handle / SlabSize][handle % SlabSize]; }
+
+    size_t capacity() const { return slabs_.size() * SlabSize; }
+    size_t size() const { return capacity() - freeSlots_.size(); }
+
+private:
+    std::pmr::memory_resource* resource_;
+    std::pmr::vector<T*> slabs_;
+    std::pmr::vector<uint32_t> freeSlots_;
+
+    void addSlab() {
+        T* slab = static_cast<T*>(resource_->allocate(sizeof(T) * SlabSize, alignof(T)));
+        for (size_t i = 0; i < SlabSize; ++i) {
+            new (&slab[i]) T();
+        }
+        uint32_t first = static_cast<uint32_t>(capacity());
+        slabs_.push_back(slab);
+        // Reserve room for every slot so release() never allocates
+        freeSlots_.reserve(capacity());
+        for (size_t i = SlabSize; i > 0; --i) {
+            freeSlots_.push_back(first + static_cast<uint32_t>(i - 1));
+        }
+    }
+};
+
+#endif // SLAB_POOL_H
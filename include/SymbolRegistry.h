@@ -0,0 +1,52 @@
+#ifndef SYMBOL_REGISTRY_H
+#define SYMBOL_REGISTRY_H
+
+#include <string>
+#include <memory>
+#include <atomic>
+#include <unordered_map>
+#include <shared_mutex>
+#include <cstdint>
+#include <cstddef>
+
+// Dense numeric symbol identifier assigned by the SymbolRegistry
+using SymbolId = uint32_t;
+constexpr SymbolId kInvalidSymbolId = UINT32_MAX;
+
+// Upper bound on the number of distinct symbols, so per-symbol tables can be flat arrays
+constexpr size_t kMaxSymbols = 16384;
+
+// Process-wide symbol interning table. Symbol names are translated to dense
+// IDs when they enter the system (protocol, configuration) and back to names
+// only at the edges (notifications, JSON, database).
+class SymbolRegistry {
+public:
+    static SymbolRegistry& instance();
+    
+    // Get the ID for a symbol, assigning the next free one if it is new.
+    // Returns kInvalidSymbolId for an empty name or when the registry is full.
+    SymbolId intern(const std::string& name);
+    
+    // Get the ID for a known symbol, or kInvalidSymbolId
+    SymbolId find(const std::string& name) const;
+    
+    // Get the name of a symbol (reference stays valid for the process lifetime).
+    // Lock-free, so the matching threads can render names for every trade.
+    const std::string& getName(SymbolId id) const;
+    
+    // Number of symbols interned so far
+    size_t size() const { return size_.load(std::memory_order_acquire); }
+    
+private:
+    SymbolRegistry();
+    
+    mutable std::shared_mutex mutex_; // Guards ids_ and writes to names_
+    std::unordered_map<std::string, SymbolId> ids_;
+    // SymbolId -> name. Names are only ever appended: a slot is written once,
+    // before size_ is raised past it with a release store, so readers below
+    // size_ need no lock.
+    std::unique_ptr<std::string[]> names_;
+    std::atomic<size_t> size_;
+};
+
+#endif // SYMBOL_REGISTRY_H
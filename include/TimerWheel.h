@@ -0,0 +1,144 @@
+#ifndef TIMER_WHEEL_H
+#define TIMER_WHEEL_H
+
+#include <array>
+#include <vector>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+// Wall-clock milliseconds since the Unix epoch, the unit of order expiry times
+inline uint64_t currentTimeMillis() {
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count());
+}
+
+// Hierarchical timing wheel with millisecond ticks. Level L has 64 slots of
+// 64^L ticks each, so five levels cover about twelve days; later deadlines
+// park in the top level and are re-placed as it turns. Scheduling is O(1), and
+// advancing fires each entry after at most one cascade per level. Entries are
+// never removed: the owner checks, when one fires, whether it still applies.
+class TimerWheel {
+public:
+    struct Entry {
+        uint64_t id;
+        uint64_t deadline;
+    };
+
+    // Ticks before startTime are considered already processed
+    explicit TimerWheel(uint64_t startTime) : current_(startTime), size_(0), levelSizes_() {}
+
+    // Schedule id to fire at deadline; deadlines already passed fire on the
+    // next advance
+    void schedule(uint64_t id, uint64_t deadline) {
+        place(Entry{id, deadline});
+        ++size_;
+    }
+
+    // Fire every entry with deadline <= now, calling fn(id, deadline)
+    template <typename Fn>
+    size_t advance(uint64_t now, Fn&& fn) {
+        if (size_ == 0) {
+            // Nothing scheduled: skip the idle ticks
+            if (now >= current_) {
+                current_ = now + 1;
+            }
+            return 0;
+        }
+
+        size_t fired = 0;
+        while (current_ <= now && size_ > 0) {
+            // Pull the next stretch of each coarser level down as its window opens
+            for (size_t level = kLevels - 1; level > 0; --level) {
+                if ((current_ & (slotSpan(level) - 1)) == 0) {
+                    cascade(level, slotIndex(level, current_));
+                }
+            }
+
+            std::vector<Entry>& slot = slots_[0][current_ & kSlotMask];
+            if (!slot.empty()) {
+                scratch_.swap(slot);
+                size_ -= scratch_.size();
+                levelSizes_[0] -= scratch_.size();
+                fired += scratch_.size();
+                for (const Entry& entry : scratch_) {
+                    fn(entry.id, entry.deadline);
+                }
+                scratch_.clear();
+            }
+            ++current_;
+            skipEmptyTicks(now);
+        }
+        if (size_ == 0 && now >= current_) {
+            current_ = now + 1;
+        }
+        return fired;
+    }
+
+    size_t size() const { return size_; }
+    bool empty() const { return size_ == 0; }
+
+private:
+    static constexpr size_t kLevels = 5;
+    static constexpr size_t kSlotBits = 6;
+    static constexpr size_t kSlots = size_t(1) << kSlotBits;
+    static constexpr uint64_t kSlotMask = kSlots - 1;
+
+    // Next tick to process
+    uint64_t current_;
+    size_t size_;
+    std::array<size_t, kLevels> levelSizes_;
+    std::array<std::array<std::vector<Entry>, kSlots>, kLevels> slots_;
+    std::vector<Entry> scratch_; // Slot being fired or cascaded; reused
+
+    static uint64_t slotSpan(size_t level) { return uint64_t(1) << (kSlotBits * level); }
+
+    static size_t slotIndex(size_t level, uint64_t time) {
+        return (time >> (kSlotBits * level)) & kSlotMask;
+    }
+
+    void place(const Entry& entry) {
+        uint64_t deadline = entry.deadline < current_ ? current_ : entry.deadline;
+        uint64_t delta = deadline - current_;
+        size_t level = 0;
+        while (level < kLevels - 1 && delta >= slotSpan(level + 1)) {
+            ++level;
+        }
+        if (level == kLevels - 1 && delta >= slotSpan(kLevels)) {
+            // Beyond the wheel: park in the furthest top-level slot
+            deadline = current_ + slotSpan(kLevels) - 1;
+        }
+        slots_[level][slotIndex(level, deadline)].push_back(entry);
+        ++levelSizes_[level];
+    }
+
+    // With the finer levels empty nothing can fire or cascade before the next
+    // slot boundary of the finest occupied level, so jump there (or past now)
+    void skipEmptyTicks(uint64_t now) {
+        size_t level = 0;
+        while (level < kLevels && levelSizes_[level] == 0) {
+            ++level;
+        }
+        if (level == 0 || level == kLevels) {
+            return;
+        }
+        uint64_t span = slotSpan(level);
+        uint64_t boundary = (current_ + span - 1) & ~(span - 1);
+        current_ = boundary > now ? now + 1 : boundary;
+    }
+
+    void cascade(size_t level, size_t index) {
+        std::vector<Entry>& slot = slots_[level][index];
+        if (slot.empty()) {
+            return;
+        }
+        std::vector<Entry> entries;
+        entries.swap(slot);
+        levelSizes_[level] -= entries.size();
+        for (const Entry& entry : entries) {
+            place(entry);
+        }
+    }
+};
+
+#endif // TIMER_WHEEL_H
@@ -3,6 +3,35 @@
 
 #include <string>
 #include <chrono>
+#include <cstdint>
+#include <stdexcept>
+#include <cstdio>
+#include <type_traits>
+#include "Price.h"
+#include "SymbolRegistry.h"
+#include "TraderRegistry.h"
+
+// Server-assigned order identifier. Text IDs ("ORD_<n>") exist only at the
+// protocol, JSON and database edges.
+using OrderId = uint64_t;
+
+inline std::string formatOrderId(OrderId orderId) {
+    return "ORD_" + std::to_string(orderId);
+}
+
+// Parse "ORD_<n>" (or a bare "<n>"); returns false if text is not an order ID
+inline bool parseOrderId(const std::string& text, OrderId& orderId) {
+    size_t start = (text.compare(0, 4, "ORD_") == 0) ? 4 : 0;
+    if (start == text.size() || text.find_first_not_of("0123456789", start) != std::string::npos) {
+        return false;
+    }
+    try {
+        orderId = std::stoull(text.substr(start));
+    } catch (const std::exception&) {
+        return false;
+    }
+    return true;
+}
 
 enum class OrderSide {
     BUY,
@@ -11,7 +40,25 @@ enum class OrderSide {
 
 enum class OrderType {
     MARKET,
-    LIMIT
+    LIMIT,
+    STOP,       // Becomes a MARKET order once a trade prints at or through stopPrice
+    STOP_LIMIT  // Becomes a LIMIT order at price once a trade prints at or through stopPrice
+};
+
+// How long an unfilled limit remainder lives
+enum class TimeInForce {
+    GTC,  // Rest in the book until filled or cancelled
+    IOC,  // Immediate or cancel: fill what crosses now, cancel the remainder
+    FOK,  // Fill or kill: fill the whole quantity now or nothing
+    GTD   // Rest in the book until filled, cancelled or expireTime
+};
+
+// What happens when an order would match another order of the same trader
+enum class SelfTradePrevention {
+    NONE,             // Allow the self-trade
+    CANCEL_NEWEST,    // Cancel the incoming order's remainder
+    CANCEL_OLDEST,    // Cancel the resting order and keep matching
+    DECREMENT_BOTH    // Reduce both by the smaller open quantity without trading
 };
 
 enum class OrderStatus {
@@ -22,35 +69,92 @@ enum class OrderStatus {
     REJECTED
 };
 
+// Why an order was REJECTED, reported in ORDER_REJECTED acknowledgements
+enum class OrderRejectReason : uint8_t {
+    NONE,
+    MALFORMED,            // Missing required fields
+    UNKNOWN_SYMBOL,       // Symbol could not be registered
+    INVALID_SIDE,
+    INVALID_TYPE,
+    INVALID_PRICE,        // Not a number, negative, or off the tick grid
+    INVALID_QUANTITY,     // Not a positive number
+    INVALID_FIELD,        // Unknown or malformed optional field
+    INCONSISTENT_FIELDS,  // Fields that do not go together (e.g. GTD without an expiry)
+    UNKNOWN_TRADER,
+    UNAVAILABLE           // The matching thread is not accepting orders
+};
+
+inline const char* orderRejectReasonText(OrderRejectReason reason) {
+    switch (reason) {
+        case OrderRejectReason::NONE: return "Invalid order";
+        case OrderRejectReason::MALFORMED: return "Malformed order";
+        case OrderRejectReason::UNKNOWN_SYMBOL: return "Unknown symbol";
+        case OrderRejectReason::INVALID_SIDE: return "Invalid side";
+        case OrderRejectReason::INVALID_TYPE: return "Invalid type";
+        case OrderRejectReason::INVALID_PRICE: return "Invalid price";
+        case OrderRejectReason::INVALID_QUANTITY: return "Invalid quantity";
+        case OrderRejectReason::INVALID_FIELD: return "Invalid field";
+        case OrderRejectReason::INCONSISTENT_FIELDS: return "Inconsistent fields";
+        case OrderRejectReason::UNKNOWN_TRADER: return "Unknown trader";
+        case OrderRejectReason::UNAVAILABLE: return "Market unavailable";
+    }
+    return "Invalid order";
+}
+
 struct Order {
-    std::string orderId;
+    OrderId orderId;
+    uint64_t clientOrderId; // Optional client-chosen ID echoed in acks (0 = none)
     std::string traderId;
-    std::string symbol;
+    TraderKey traderKey;    // Interned traderId, compared for self-trade prevention
+    SymbolId symbol;
     OrderSide side;
     OrderType type;
-    double price;      // For limit orders
+    TimeInForce timeInForce;
+    SelfTradePrevention selfTradePrevention;
+    Price price;       // For limit orders, in ticks
+    Price stopPrice;   // For stop orders, in ticks
     double quantity;
     double filledQuantity;
+    double displayQuantity; // Iceberg slice size; 0 = whole order displayed
+    double visibleQuantity; // While resting: open quantity of the displayed slice (set by the book)
+    uint64_t expireTime;    // GTD expiry, milliseconds since the Unix epoch (0 = none)
     OrderStatus status;
+    OrderRejectReason rejectReason; // Set with status REJECTED
     std::chrono::system_clock::time_point timestamp;
     
-    Order() : price(0.0), quantity(0.0), filledQuantity(0.0), 
-              status(OrderStatus::PENDING) {}
+    Order() : orderId(0), clientOrderId(0), traderKey(kInvalidTraderKey), symbol(kInvalidSymbolId),
+              timeInForce(TimeInForce::GTC), selfTradePrevention(SelfTradePrevention::NONE),
+              price(0), stopPrice(0), quantity(0.0), filledQuantity(0.0), displayQuantity(0.0), visibleQuantity(0.0),
+              expireTime(0), status(OrderStatus::PENDING), rejectReason(OrderRejectReason::NONE) {}
 };
 
+// Trade identifier from the owning matching shard's sequence; rendered as
+// text ("TRADE_<n>") only at the protocol and database edges
+using TradeId = uint64_t;
+
+inline std::string formatTradeId(TradeId tradeId) {
+    char buffer[32];
+    int length = std::snprintf(buffer, sizeof(buffer), "TRADE_%08llu",
+                               static_cast<unsigned long long>(tradeId));
+    return std::string(buffer, static_cast<size_t>(length));
+}
+
+// Fill record: integers only, so creating one allocates nothing and copying
+// one is a memcpy. Trader IDs are interned (TraderRegistry).
 struct Trade {
-    std::string tradeId;
-    std::string buyOrderId;
-    std::string sellOrderId;
-    std::string buyTraderId;
-    std::string sellTraderId;
-    std::string symbol;
-    double price;
-    double quantity;
+    TradeId tradeId = 0;
+    OrderId buyOrderId = 0;
+    OrderId sellOrderId = 0;
+    TraderKey buyTraderKey = kInvalidTraderKey;
+    TraderKey sellTraderKey = kInvalidTraderKey;
+    SymbolId symbol = kInvalidSymbolId;
+    Price price = 0;       // In ticks
+    double quantity = 0.0;
     std::chrono::system_clock::time_point timestamp;
-    
-    Trade() : price(0.0), quantity(0.0) {}
 };
 
+static_assert(std::is_trivially_copyable<Trade>::value, "Trade must stay a flat record");
+static_assert(sizeof(Trade) <= 64, "Trade should fit in a cache line");
+
 #endif // TRADE_H
 
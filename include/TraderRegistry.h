@@ -0,0 +1,52 @@
+#ifndef TRADER_REGISTRY_H
+#define TRADER_REGISTRY_H
+
+#include <string>
+#include <memory>
+#include <atomic>
+#include <unordered_map>
+#include <shared_mutex>
+#include <cstdint>
+#include <cstddef>
+
+// Dense numeric trader identifier assigned by the TraderRegistry
+using TraderKey = uint32_t;
+constexpr TraderKey kInvalidTraderKey = UINT32_MAX;
+
+// Upper bound on the number of distinct traders; trader IDs are stored in
+// chunks of kTraderChunkSize allocated as they fill
+constexpr size_t kMaxTraders = size_t(1) << 24;
+constexpr size_t kTraderChunkSize = 4096;
+
+// Process-wide trader interning table, so the matching loop can tell whether
+// two orders belong to the same trader with one integer compare
+class TraderRegistry {
+public:
+    static TraderRegistry& instance();
+    
+    // Get the key for a trader ID, assigning the next free one if it is new.
+    // Returns kInvalidTraderKey for an empty ID or when the registry is full.
+    TraderKey intern(const std::string& traderId);
+    
+    // Get the key for a known trader ID, or kInvalidTraderKey
+    TraderKey find(const std::string& traderId) const;
+    
+    // Get the trader ID for a key (reference stays valid for the process
+    // lifetime). Lock-free, so the matching threads can look up both sides of
+    // every trade.
+    const std::string& getTraderId(TraderKey key) const;
+    
+private:
+    TraderRegistry();
+    
+    mutable std::shared_mutex mutex_; // Guards keys_ and writes to the chunks
+    std::unordered_map<std::string, TraderKey> keys_;
+    // TraderKey -> trader ID, in chunks that are never moved or freed. IDs
+    // are only ever appended: a slot (and its chunk) is written once, before
+    // size_ is raised past it with a release store, so readers below size_
+    // need no lock.
+    std::unique_ptr<std::unique_ptr<std::string[]>[]> chunks_;
+    std::atomic<size_t> size_;
+};
+
+#endif // TRADER_REGISTRY_H
@@ -41,6 +41,7 @@ private:
     
     std::string getOrderBookJson(const std::string& symbol);
     std::string getAllOrderBooksJson();
+    std::string getDepthJson(const std::string& symbol, size_t nLevels);
     std::string getAccountJson(const std::string& accountId);
     std::string getAllAccountsJson();
     std::string getStatsJson();
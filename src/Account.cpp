@@ -5,18 +5,28 @@ Account::Account(const std::string& accountId, double initialBalance)
     : accountId_(accountId), balance_(initialBalance) {
 }
 
-double Account::getPosition(const std::string& symbol) const {
-    auto it = positions_.find(symbol);
-    if (it != positions_.end()) {
-        return it->second;
+double Account::getBalance() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return balance_;
+}
+
+double Account::getPosition(SymbolId symbol) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (symbol < positions_.size()) {
+        return positions_[symbol];
     }
     return 0.0;
 }
 
+double Account::getPosition(const std::string& symbol) const {
+    return getPosition(SymbolRegistry::instance().find(symbol));
+}
+
 void Account::deposit(double amount) {
     if (amount < 0) {
         throw std::invalid_argument("Deposit amount must be positive");
     }
+    std::lock_guard<std::mutex> lock(mutex_);
     balance_ += amount;
 }
 
@@ -24,6 +34,7 @@ bool Account::withdraw(double amount) {
     if (amount < 0) {
         throw std::invalid_argument("Withdraw amount must be positive");
     }
+    std::lock_guard<std::mutex> lock(mutex_);
     if (balance_ >= amount) {
         balance_ -= amount;
         return true;
@@ -31,10 +42,15 @@ bool Account::withdraw(double amount) {
     return false;
 }
 
-void Account::updatePosition(const std::string& symbol, double quantity) {
-    positions_[symbol] += quantity;
-    if (positions_[symbol] == 0.0) {
-        positions_.erase(symbol);
+double Account::updatePosition(SymbolId symbol, double quantity) {
+    if (symbol == kInvalidSymbolId) {
+        throw std::invalid_argument("Invalid symbol");
     }
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (symbol >= positions_.size()) {
+        positions_.resize(symbol + 1, 0.0);
+    }
+    positions_[symbol] += quantity;
+    return positions_[symbol];
 }
 
@@ -1,4 +1,5 @@
 #include "MarketServer.h"
+#include "OrderParser.h"
 #include <sys/socket.h>
 #include <netinet/in.h>
 #include <arpa/inet.h>
@@ -9,27 +10,126 @@
 #include <algorithm>
 #include <set>
 #include <errno.h>
+#include <thread>
+#include <cmath>
 
-MarketServer::MarketServer(int port) 
+namespace {
+constexpr size_t kMaxDefaultMatchingThreads = 4;
+constexpr size_t kMaxDefaultSessionThreads = 2;
+
+// "ORD_<id>[:CLID=<n>]" as used in acknowledgements and order notifications
+std::string orderReference(const Order& order) {
+    std::string orderRef = formatOrderId(order.orderId);
+    if (order.clientOrderId != 0) {
+        orderRef += ":CLID=" + std::to_string(order.clientOrderId);
+    }
+    return orderRef;
+}
+
+// A binary message as the bytes notifyTrader sends to binary sessions
+template <typename Message>
+std::string encodeBinary(const Message& message) {
+    std::string bytes;
+    appendBinaryMessage(bytes, message);
+    return bytes;
+}
+
+// The binary form of an order's reject reason
+BinaryRejectReason binaryRejectReason(OrderRejectReason reason) {
+    switch (reason) {
+        case OrderRejectReason::NONE: return BinaryRejectReason::INVALID_ORDER;
+        case OrderRejectReason::MALFORMED: return BinaryRejectReason::MALFORMED;
+        case OrderRejectReason::UNKNOWN_SYMBOL: return BinaryRejectReason::UNKNOWN_SYMBOL;
+        case OrderRejectReason::INVALID_SIDE: return BinaryRejectReason::INVALID_SIDE;
+        case OrderRejectReason::INVALID_TYPE: return BinaryRejectReason::INVALID_TYPE;
+        case OrderRejectReason::INVALID_PRICE: return BinaryRejectReason::INVALID_PRICE;
+        case OrderRejectReason::INVALID_QUANTITY: return BinaryRejectReason::INVALID_QUANTITY;
+        case OrderRejectReason::INVALID_FIELD: return BinaryRejectReason::INVALID_FIELD;
+        case OrderRejectReason::INCONSISTENT_FIELDS: return BinaryRejectReason::INCONSISTENT_FIELDS;
+        case OrderRejectReason::UNKNOWN_TRADER: return BinaryRejectReason::UNKNOWN_TRADER;
+        case OrderRejectReason::UNAVAILABLE: return BinaryRejectReason::UNAVAILABLE;
+    }
+    return BinaryRejectReason::INVALID_ORDER;
+}
+
+std::string binaryReject(BinaryRejectReason reason, const Order& order) {
+    BinaryReject reject = makeBinaryMessage<BinaryReject>();
+    reject.reason = reason;
+    reject.orderId = order.orderId;
+    reject.clientOrderId = order.clientOrderId;
+    return encodeBinary(reject);
+}
+
+std::string binaryOrderDone(BinaryDoneReason reason, const Order& order) {
+    BinaryOrderDone done = makeBinaryMessage<BinaryOrderDone>();
+    done.reason = reason;
+    done.orderId = order.orderId;
+    done.clientOrderId = order.clientOrderId;
+    done.filledQuantity = order.filledQuantity;
+    return encodeBinary(done);
+}
+}
+
+MarketServer::MarketServer(int port, size_t matchingThreads, size_t sessionThreads) 
     : port_(port), serverSocket_(-1), running_(false), 
-      orderLogger_("") {  // Empty string will use environment variables
+      nextOrderId_(static_cast<OrderId>(std::chrono::duration_cast<std::chrono::microseconds>(
+          std::chrono::system_clock::now().time_since_epoch()).count())),
+      orderBooks_(new std::atomic<OrderBook*>[kMaxSymbols]),
+      snapshots_(new std::shared_ptr<const OrderBookSnapshot>[kMaxSymbols]),
+      snapshotStale_(new bool[kMaxSymbols]()),
+      ordersStale_(new bool[kMaxSymbols]()),
+      ordersWanted_(new std::atomic<bool>[kMaxSymbols]),
+      nextReactor_(0), orderLogger_("") {
+    for (size_t i = 0; i < kMaxSymbols; ++i) {
+        orderBooks_[i].store(nullptr, std::memory_order_relaxed);
+        ordersWanted_[i].store(false, std::memory_order_relaxed);
+    }
+      // Empty string will use environment variables
     // Initialize order logger
     if (!orderLogger_.initialize()) {
         std::cerr << "Warning: Failed to initialize order logger" << std::endl;
     }
     
-    matchingEngine_.setTradeCallback(
-        [this](const Trade& trade) { 
-            this->onTradeExecuted(trade);
-            // Log trade to database
-            orderLogger_.logTrade(trade);
-        }
-    );
+    if (matchingThreads == 0) {
+        matchingThreads = std::min<size_t>(std::max(1u, std::thread::hardware_concurrency()),
+                                           kMaxDefaultMatchingThreads);
+    }
+    for (size_t i = 0; i < matchingThreads; ++i) {
+        shards_.push_back(std::make_unique<MatchingShard>(
+            i, matchingThreads,
+            [this](Order* orders, size_t count, MatchingEngine& matchingEngine,
+                   std::vector<Trade>& trades) {
+                this->executeOrders(orders, count, matchingEngine, trades);
+            },
+            [this](const ShardRequest& request, MatchingEngine& matchingEngine,
+                   std::vector<Trade>& trades) {
+                this->executeControl(request, matchingEngine, trades);
+            },
+            [this](size_t shardIndex) {
+                this->expireOrders(shardIndex);
+                this->publishSnapshots(shardIndex);
+            }));
+    }
+    shardOrderBooks_.resize(matchingThreads);
+    
+    if (sessionThreads == 0) {
+        sessionThreads = std::min<size_t>(std::max(1u, std::thread::hardware_concurrency()),
+                                          kMaxDefaultSessionThreads);
+    }
+    for (size_t i = 0; i < sessionThreads; ++i) {
+        reactors_.push_back(std::make_unique<SessionReactor>(
+            [this](Session& session) {
+                return this->handleSessionData(session);
+            },
+            [this](Session& session) {
+                this->onSessionClosed(session);
+            }));
+    }
     
     settlementEngine_.setSettlementCallback(
-        [this](const std::string& traderId, const std::string& symbol,
-               double quantity, double price) {
-            this->onSettlementComplete(traderId, symbol, quantity, price);
+        [this](const std::string& traderId, SymbolId symbol,
+               double quantity, double price, double position) {
+            this->onSettlementComplete(traderId, symbol, quantity, price, position);
         }
     );
 }
@@ -92,6 +192,13 @@ void MarketServer::start() {
         throw std::runtime_error("Failed to listen on socket");
     }
     
+    for (auto& shard : shards_) {
+        shard->start();
+    }
+    for (auto& reactor : reactors_) {
+        reactor->start();
+    }
+    
     running_ = true;
     std::cout << "Market server started on port " << port_ << std::endl;
     
@@ -111,6 +218,13 @@ void MarketServer::stop() {
         if (acceptThread_.joinable()) {
             acceptThread_.join();
         }
+        for (auto& reactor : reactors_) {
+            reactor->stop();
+        }
+        // Matching threads finish the orders already queued before exiting
+        for (auto& shard : shards_) {
+            shard->stop();
+        }
         std::cout << "Market server stopped" << std::endl;
     }
 }
@@ -131,209 +245,696 @@ void MarketServer::acceptConnections() {
         std::cout << "New client connected from " 
                   << inet_ntoa(clientAddress.sin_addr) << std::endl;
         
-        // Handle client in a separate thread
-        std::thread clientThread(&MarketServer::handleClient, this, clientSocket);
-        clientThread.detach();
+        // Hand the connection to the session reactors in turn
+        size_t reactor = nextReactor_++ % reactors_.size();
+        if (!reactors_[reactor]->addSession(clientSocket)) {
+            std::cerr << "Failed to add client session" << std::endl;
+        }
+    }
+}
+
+bool MarketServer::handleSessionData(Session& session) {
+    // Process every complete message of the read in one pass; the orders among
+    // them are submitted as a batch. A trailing partial message stays buffered.
+    static thread_local std::vector<Order> orderBatch; // Reused per reactor thread
+    while (true) {
+        if (session.protocol == Session::Protocol::BINARY) {
+            std::string_view frame;
+            if (!session.inbound.nextFrame(frame)) {
+                break;
+            }
+            if (!processBinaryMessage(session, frame, orderBatch)) {
+                orderBatch.clear();
+                return false;
+            }
+            continue;
+        }
+        
+        // Text; also how every session starts. A binary session's frames may
+        // follow its REGISTER line in the same read.
+        std::string_view line;
+        if (!session.inbound.nextLine(line)) {
+            break;
+        }
+        if (line.empty()) {
+            continue;
+        }
+        if (session.state == Session::State::AWAITING_REGISTER) {
+            // First message must be trader registration
+            if (!registerSession(session, std::string(line))) {
+                return false;
+            }
+            continue;
+        }
+        processMessage(session, line, orderBatch);
     }
+    processOrderBatch(session, orderBatch);
+    return true;
 }
 
-void MarketServer::handleClient(int clientSocket) {
-    char buffer[4096];
-    std::string traderId;
+bool MarketServer::registerSession(Session& session, const std::string& request) {
+    // Format: "REGISTER:traderId[:BINARY]"
+    if (request.compare(0, 9, "REGISTER:") != 0) {
+        return false;
+    }
+    std::string traderId = request.substr(9);
+    Session::Protocol protocol = Session::Protocol::TEXT;
+    size_t separator = traderId.find(':');
+    if (separator != std::string::npos) {
+        if (traderId.compare(separator + 1, std::string::npos, "BINARY") != 0) {
+            return false;
+        }
+        protocol = Session::Protocol::BINARY;
+        traderId.erase(separator);
+    }
+    if (traderId.empty()) {
+        return false;
+    }
     
-    // First message should be trader registration
-    ssize_t bytesRead = recv(clientSocket, buffer, sizeof(buffer) - 1, 0);
-    if (bytesRead <= 0) {
-        close(clientSocket);
-        return;
+    session.traderId = traderId;
+    session.state = Session::State::ACTIVE;
+    session.protocol = protocol;
+    
+    // Create trader and account if they don't exist
+    {
+        std::lock_guard<std::mutex> lock(tradersMutex_);
+        if (traders_.find(traderId) == traders_.end()) {
+            auto account = std::make_shared<Account>(traderId, 10000.0); // Initial balance
+            auto trader = std::make_shared<Trader>(traderId, traderId);
+            trader->setAccount(account);
+            
+            accounts_[traderId] = account;
+            traders_[traderId] = trader;
+        }
     }
     
-    buffer[bytesRead] = '\0';
-    std::string message(buffer);
+    // The reply is always text; a binary session switches format after it
+    bool binary = (protocol == Session::Protocol::BINARY);
+    session.outbox->send("REGISTERED:" + traderId + (binary ? ":BINARY\n" : "\n"));
+    
+    // Route this trader's notifications to the session
+    {
+        std::lock_guard<std::mutex> lock(socketsMutex_);
+        traderSockets_[traderId] = TraderConnection{session.outbox, protocol};
+    }
+    return true;
+}
+
+void MarketServer::onSessionClosed(Session& session) {
+    // Unregister the socket when trader disconnects
+    if (!session.traderId.empty()) {
+        std::lock_guard<std::mutex> lock(socketsMutex_);
+        auto it = traderSockets_.find(session.traderId);
+        if (it != traderSockets_.end() && it->second.outbox == session.outbox) {
+            traderSockets_.erase(it);
+        }
+    }
+    std::cout << "Client " << session.traderId << " disconnected" << std::endl;
+}
+
+void MarketServer::processMessage(Session& session, std::string_view message,
+                                  std::vector<Order>& orderBatch) {
+    // Format: "ORDER:traderId:symbol:side:type:price:quantity[:CLID=clientOrderId][:TIF=GTC|IOC|FOK|GTD][:EXPIRE=epochMillis][:STP=mode][:DISPLAY=quantity][:STOP=stopPrice]"
     
-    // Parse registration: "REGISTER:traderId"
-    if (message.substr(0, 9) == "REGISTER:") {
-        traderId = message.substr(9);
-        // Remove newline if present
-        traderId.erase(std::remove(traderId.begin(), traderId.end(), '\n'), traderId.end());
-        traderId.erase(std::remove(traderId.begin(), traderId.end(), '\r'), traderId.end());
+    if (message.compare(0, 6, "ORDER:") == 0) {
+        // Parsed straight into the batch; invalid orders get ORDER_REJECTED with the reason
+        const TickSizeLookup tickSizeOf = [this](SymbolId symbol) { return getTickSize(symbol); };
+        Order& order = orderBatch.emplace_back();
+        if (parseOrderMessage(message, order, tickSizeOf) != OrderRejectReason::MALFORMED) {
+            order.orderId = nextOrderId_.fetch_add(1, std::memory_order_relaxed);
+            order.timestamp = std::chrono::system_clock::now();
+        } else {
+            orderBatch.pop_back();
+            // Keep responses in message order
+            processOrderBatch(session, orderBatch);
+            std::string response = "ERROR:Invalid order format. Expected: ORDER:traderId:symbol:side:type:price:quantity\n";
+            session.outbox->send(std::move(response));
+        }
+    } else if (message.compare(0, 8, "AUCTION:") == 0) {
+        // Format: "AUCTION:symbol:START|UNCROSS|END"; operators only, since a
+        // phase change affects every trader in the symbol
+        processOrderBatch(session, orderBatch);
         
-        // Create trader and account if they don't exist
+        bool isOperator;
         {
             std::lock_guard<std::mutex> lock(tradersMutex_);
-            if (traders_.find(traderId) == traders_.end()) {
-                auto account = std::make_shared<Account>(traderId, 10000.0); // Initial balance
-                auto trader = std::make_shared<Trader>(traderId, traderId);
-                trader->setAccount(account);
-                
-                accounts_[traderId] = account;
-                traders_[traderId] = trader;
-            }
+            isOperator = operators_.count(session.traderId) > 0;
+        }
+        if (!isOperator) {
+            session.outbox->send("ERROR:Not authorized: AUCTION requires an operator session\n");
+            return;
         }
         
-        std::string response = "REGISTERED:" + traderId + "\n";
-        send(clientSocket, response.c_str(), response.length(), 0);
+        std::string request(message.substr(8));
+        size_t separator = request.find(':');
+        std::string symbol = request.substr(0, separator);
+        std::string action = (separator != std::string::npos) ? request.substr(separator + 1) : "";
         
-        // Register the socket for this trader
-        {
-            std::lock_guard<std::mutex> lock(socketsMutex_);
-            traderSockets_[traderId] = clientSocket;
+        bool queued = false;
+        if (action == "START") {
+            queued = startAuction(symbol);
+        } else if (action == "UNCROSS") {
+            queued = uncrossAuction(symbol);
+        } else if (action == "END") {
+            queued = endAuction(symbol);
         }
-    } else {
-        close(clientSocket);
-        return;
-    }
-    
-    // Process messages
-    while (running_) {
-        bytesRead = recv(clientSocket, buffer, sizeof(buffer) - 1, 0);
-        if (bytesRead <= 0) {
-            break;
+        
+        std::string response = queued ? "AUCTION_ACCEPTED:" + symbol + ":" + action + "\n"
+                                      : "ERROR:Invalid auction request. Expected: AUCTION:symbol:START|UNCROSS|END\n";
+        session.outbox->send(std::move(response));
+    } else if (message.compare(0, 7, "CANCEL:") == 0 || message.compare(0, 8, "REPLACE:") == 0) {
+        // Format: "CANCEL:traderId:symbol:orderId" or
+        //         "REPLACE:traderId:symbol:orderId:price:quantity"
+        // The outcome (ORDER_CANCELLED/ORDER_REPLACED or CANCEL_REJECTED/REPLACE_REJECTED)
+        // comes from the matching thread; requests that fail to parse or name another
+        // trader are answered here
+        processOrderBatch(session, orderBatch);
+        
+        const TickSizeLookup tickSizeOf = [this](SymbolId symbol) { return getTickSize(symbol); };
+        CancelReplaceRequest request;
+        OrderRejectReason reason = parseCancelReplaceMessage(message, request, tickSizeOf);
+        if (reason == OrderRejectReason::MALFORMED) {
+            std::string response = request.isCancel
+                ? "ERROR:Invalid cancel request. Expected: CANCEL:traderId:symbol:orderId\n"
+                : "ERROR:Invalid replace request. Expected: REPLACE:traderId:symbol:orderId:price:quantity\n";
+            session.outbox->send(std::move(response));
+            return;
         }
         
-        buffer[bytesRead] = '\0';
-        message = std::string(buffer);
+        std::string rejected = std::string(request.isCancel ? "CANCEL_REJECTED:" : "REPLACE_REJECTED:") +
+                               formatOrderId(request.orderId) + ":";
+        if (request.traderId != session.traderId) {
+            // A session may only act for the trader it registered as; answer as
+            // the matching thread does for an order that isn't the sender's
+            session.outbox->send(rejected + "Unknown order\n");
+            return;
+        }
+        if (reason != OrderRejectReason::NONE) {
+            session.outbox->send(rejected + orderRejectReasonText(reason) + "\n");
+            return;
+        }
         
-        processMessage(clientSocket, message);
+        bool queued = request.isCancel
+            ? enqueueCancel(session.traderId, request.symbol, request.orderId)
+            : enqueueReplace(session.traderId, request.symbol, request.orderId,
+                             request.price, request.quantity);
+        if (!queued) {
+            session.outbox->send(rejected + orderRejectReasonText(OrderRejectReason::UNAVAILABLE) + "\n");
+        }
     }
-    
-    // Unregister the socket when trader disconnects
-    if (!traderId.empty()) {
-        std::lock_guard<std::mutex> lock(socketsMutex_);
-        traderSockets_.erase(traderId);
+}
+
+void MarketServer::processOrderBatch(Session& session, std::vector<Order>& orderBatch) {
+    if (orderBatch.empty()) {
+        return;
     }
     
-    close(clientSocket);
-    std::cout << "Client " << traderId << " disconnected" << std::endl;
+    // Acknowledge before queuing, so the matching thread's fills and
+    // cancels for an order always follow its acknowledgement on the session
+    validateOrders(orderBatch.data(), orderBatch.size());
+    sendOrderAcks(session, orderBatch);
+    for (auto& order : orderBatch) {
+        if (order.status != OrderStatus::REJECTED && !enqueueOrder(order)) {
+            // Too late to reject (the server is stopping); the order ends
+            // before reaching the book
+            order.status = OrderStatus::CANCELLED;
+            session.outbox->send(session.protocol == Session::Protocol::BINARY
+                                     ? binaryOrderDone(BinaryDoneReason::CANCELLED, order)
+                                     : "ORDER_CANCELLED:" + orderReference(order) + ":0\n");
+        }
+    }
+    orderBatch.clear();
+}
+
+void MarketServer::sendOrderAcks(Session& session, const std::vector<Order>& orderBatch) {
+    // One acknowledgement per order, sent together
+    std::string response;
+    if (session.protocol == Session::Protocol::BINARY) {
+        for (const auto& order : orderBatch) {
+            if (order.status != OrderStatus::REJECTED) {
+                BinaryAck ack = makeBinaryMessage<BinaryAck>();
+                ack.orderId = order.orderId;
+                ack.clientOrderId = order.clientOrderId;
+                appendBinaryMessage(response, ack);
+            } else {
+                BinaryReject reject = makeBinaryMessage<BinaryReject>();
+                reject.reason = binaryRejectReason(order.rejectReason);
+                reject.orderId = order.orderId;
+                reject.clientOrderId = order.clientOrderId;
+                appendBinaryMessage(response, reject);
+            }
+        }
+        session.outbox->send(std::move(response));
+        return;
+    }
+    for (const auto& order : orderBatch) {
+        std::string orderRef = orderReference(order);
+        if (order.status != OrderStatus::REJECTED) {
+            response += "ORDER_ACCEPTED:" + orderRef + "\n";
+        } else {
+            response += "ORDER_REJECTED:" + orderRef + ":" +
+                        orderRejectReasonText(order.rejectReason) + "\n";
+        }
+    }
+    session.outbox->send(std::move(response));
 }
 
-void MarketServer::processMessage(int clientSocket, const std::string& message) {
-    // Format: "ORDER:traderId:symbol:side:type:price:quantity"
+bool MarketServer::processBinaryMessage(Session& session, std::string_view frame,
+                                        std::vector<Order>& orderBatch) {
+    BinaryHeader header;
+    if (frame.size() < sizeof(header)) {
+        return false; // Not even a header: the stream cannot be trusted
+    }
+    std::memcpy(&header, frame.data(), sizeof(header));
     
-    if (message.substr(0, 6) == "ORDER:") {
-        std::istringstream iss(message.substr(6));
-        std::string token;
-        std::vector<std::string> tokens;
-        
-        while (std::getline(iss, token, ':')) {
-            // Remove newline if present
-            token.erase(std::remove(token.begin(), token.end(), '\n'), token.end());
-            token.erase(std::remove(token.begin(), token.end(), '\r'), token.end());
-            if (!token.empty()) {
-                tokens.push_back(token);
+    switch (header.type) {
+        case BinaryMessageType::NEW_ORDER: {
+            BinaryNewOrder message;
+            if (!decodeBinaryMessage(frame, message)) {
+                break;
             }
+            orderBatch.push_back(decodeBinaryOrder(message, session.traderId));
+            return true;
         }
-        
-        if (tokens.size() >= 6) {
-            std::string traderId = tokens[0];
-            Order order = parseOrderMessage(message, traderId);
-            
-            if (submitOrder(order)) {
-                std::string response = "ORDER_ACCEPTED:" + order.orderId + "\n";
-                send(clientSocket, response.c_str(), response.length(), 0);
-            } else {
-                std::string response = "ORDER_REJECTED:" + order.orderId + ":Invalid order\n";
-                send(clientSocket, response.c_str(), response.length(), 0);
+        case BinaryMessageType::CANCEL: {
+            BinaryCancel message;
+            if (!decodeBinaryMessage(frame, message)) {
+                break;
             }
-        } else {
-            std::string response = "ERROR:Invalid order format. Expected: ORDER:traderId:symbol:side:type:price:quantity\n";
-            send(clientSocket, response.c_str(), response.length(), 0);
+            // Keep responses in message order
+            processOrderBatch(session, orderBatch);
+            SymbolId symbol = SymbolRegistry::instance().find(std::string(binarySymbol(message.symbol)));
+            if (symbol == kInvalidSymbolId ||
+                !enqueueCancel(session.traderId, symbol, message.orderId)) {
+                sendBinaryReject(session, BinaryRejectReason::UNKNOWN_ORDER,
+                                 message.orderId, 0);
+            }
+            return true;
+        }
+        case BinaryMessageType::REPLACE: {
+            BinaryReplace message;
+            if (!decodeBinaryMessage(frame, message)) {
+                break;
+            }
+            processOrderBatch(session, orderBatch);
+            SymbolId symbol = SymbolRegistry::instance().find(std::string(binarySymbol(message.symbol)));
+            if (symbol == kInvalidSymbolId ||
+                !enqueueReplace(session.traderId, symbol, message.orderId, message.price,
+                                message.quantity)) {
+                sendBinaryReject(session, BinaryRejectReason::INVALID_REPLACE,
+                                 message.orderId, 0);
+            }
+            return true;
         }
+        default:
+            break;
     }
+    
+    // Unknown type or wrong length; the length prefix still delimits the
+    // next message, so refuse this one and carry on
+    processOrderBatch(session, orderBatch);
+    sendBinaryReject(session, BinaryRejectReason::MALFORMED, 0, 0);
+    return true;
 }
 
-Order MarketServer::parseOrderMessage(const std::string& message, const std::string& traderId) {
+Order MarketServer::decodeBinaryOrder(const BinaryNewOrder& message, const std::string& traderId) {
     Order order;
     order.traderId = traderId;
-    order.orderId = "ORD_" + std::to_string(std::chrono::system_clock::now().time_since_epoch().count());
+    order.traderKey = TraderRegistry::instance().intern(traderId);
+    order.orderId = nextOrderId_.fetch_add(1, std::memory_order_relaxed);
+    order.clientOrderId = message.clientOrderId;
     order.timestamp = std::chrono::system_clock::now();
     order.filledQuantity = 0.0;
     order.status = OrderStatus::PENDING;
     
-    // Format: "ORDER:traderId:symbol:side:type:price:quantity"
-    std::istringstream iss(message.substr(6));
-    std::string token;
-    std::vector<std::string> tokens;
+    // Checked in the text parser's order, so both protocols report the same first problem
+    auto reject = [&order](OrderRejectReason reason) {
+        order.status = OrderStatus::REJECTED;
+        order.rejectReason = reason;
+        return order;
+    };
+    order.symbol = SymbolRegistry::instance().intern(std::string(binarySymbol(message.symbol)));
+    if (order.symbol == kInvalidSymbolId) {
+        return reject(OrderRejectReason::UNKNOWN_SYMBOL);
+    }
+    if (message.side > static_cast<uint8_t>(OrderSide::SELL)) {
+        return reject(OrderRejectReason::INVALID_SIDE);
+    }
+    if (message.orderType > static_cast<uint8_t>(OrderType::STOP_LIMIT)) {
+        return reject(OrderRejectReason::INVALID_TYPE);
+    }
+    order.side = static_cast<OrderSide>(message.side);
+    order.type = static_cast<OrderType>(message.orderType);
+    order.price = message.price;
+    order.stopPrice = message.stopPrice;
+    order.quantity = message.quantity;
+    order.displayQuantity = message.displayQuantity;
+    order.expireTime = message.expireTime;
     
-    while (std::getline(iss, token, ':')) {
-        // Remove newline if present
-        token.erase(std::remove(token.begin(), token.end(), '\n'), token.end());
-        token.erase(std::remove(token.begin(), token.end(), '\r'), token.end());
-        if (!token.empty()) {
-            tokens.push_back(token);
-        }
+    if (order.price < 0 ||
+        (order.price == 0 && (order.type == OrderType::LIMIT || order.type == OrderType::STOP_LIMIT))) {
+        return reject(OrderRejectReason::INVALID_PRICE);
+    }
+    // Raw doubles may be anything, NaN and infinity included
+    if (!std::isfinite(order.quantity) || !(order.quantity > 0)) {
+        return reject(OrderRejectReason::INVALID_QUANTITY);
     }
+    if (message.timeInForce > static_cast<uint8_t>(TimeInForce::GTD) ||
+        message.selfTradePrevention > static_cast<uint8_t>(SelfTradePrevention::DECREMENT_BOTH) ||
+        !std::isfinite(order.displayQuantity) || !(order.displayQuantity >= 0)) {
+        return reject(OrderRejectReason::INVALID_FIELD);
+    }
+    order.timeInForce = static_cast<TimeInForce>(message.timeInForce);
+    order.selfTradePrevention = static_cast<SelfTradePrevention>(message.selfTradePrevention);
+    if (!hasConsistentOrderFields(order)) {
+        return reject(OrderRejectReason::INCONSISTENT_FIELDS);
+    }
+    return order;
+}
+
+void MarketServer::sendBinaryReject(Session& session, BinaryRejectReason reason, OrderId orderId,
+                                    uint64_t clientOrderId) {
+    BinaryReject reject = makeBinaryMessage<BinaryReject>();
+    reject.reason = reason;
+    reject.orderId = orderId;
+    reject.clientOrderId = clientOrderId;
+    std::string response;
+    appendBinaryMessage(response, reject);
+    session.outbox->send(std::move(response));
+}
+
+bool MarketServer::submitOrder(const Order& order) {
+    Order submitted = order;
+    return submitOrders(&submitted, 1) == 1;
+}
+
+size_t MarketServer::submitOrders(Order* orders, size_t count) {
+    validateOrders(orders, count);
     
-    if (tokens.size() >= 6) {
-        order.symbol = tokens[1];
-        order.side = (tokens[2] == "BUY") ? OrderSide::BUY : OrderSide::SELL;
-        order.type = (tokens[3] == "MARKET") ? OrderType::MARKET : OrderType::LIMIT;
-        try {
-            order.price = std::stod(tokens[4]);
-            order.quantity = std::stod(tokens[5]);
-        } catch (const std::exception& e) {
+    size_t accepted = 0;
+    for (size_t i = 0; i < count; ++i) {
+        Order& order = orders[i];
+        if (order.status == OrderStatus::REJECTED) {
+            continue;
+        }
+        if (enqueueOrder(order)) {
+            ++accepted;
+        } else {
             order.status = OrderStatus::REJECTED;
+            order.rejectReason = OrderRejectReason::UNAVAILABLE;
         }
-    } else {
-        order.status = OrderStatus::REJECTED;
     }
-    
-    return order;
+    return accepted;
 }
 
-bool MarketServer::submitOrder(const Order& order) {
-    // Validate trader exists
+void MarketServer::validateOrders(Order* orders, size_t count) {
+    // Validate traders exist
     {
         std::lock_guard<std::mutex> lock(tradersMutex_);
-        if (traders_.find(order.traderId) == traders_.end()) {
+        for (size_t i = 0; i < count; ++i) {
+            Order& order = orders[i];
+            if (order.status == OrderStatus::REJECTED) {
+                continue;
+            }
+            if (order.symbol >= kMaxSymbols) {
+                order.status = OrderStatus::REJECTED;
+                order.rejectReason = OrderRejectReason::UNKNOWN_SYMBOL;
+            } else if (traders_.find(order.traderId) == traders_.end()) {
+                order.status = OrderStatus::REJECTED;
+                order.rejectReason = OrderRejectReason::UNKNOWN_TRADER;
+            }
+        }
+    }
+    
+    for (size_t i = 0; i < count; ++i) {
+        Order& order = orders[i];
+        if (order.status != OrderStatus::REJECTED && order.traderKey == kInvalidTraderKey) {
+            order.traderKey = TraderRegistry::instance().intern(order.traderId);
+            if (order.traderKey == kInvalidTraderKey) {
+                order.status = OrderStatus::REJECTED;
+                order.rejectReason = OrderRejectReason::UNKNOWN_TRADER;
+            }
+        }
+    }
+}
+
+bool MarketServer::enqueueOrder(const Order& order) {
+    ShardRequest request;
+    request.order = order;
+    return enqueueRequest(std::move(request));
+}
+
+bool MarketServer::enqueueRequest(ShardRequest&& request) {
+    // Create the order book here so the matching thread finds it without locking
+    getOrderBook(request.order.symbol);
+    
+    // Hand the request to the thread that owns the symbol
+    MatchingShard& shard = *shards_[request.order.symbol % shards_.size()];
+    while (!shard.tryEnqueue(std::move(request))) {
+        if (!shard.isRunning()) {
             return false;
         }
+        std::this_thread::yield(); // Queue full: wait for the matching thread
+    }
+    
+    return true;
+}
+
+void MarketServer::executeOrders(Order* orders, size_t count, MatchingEngine& matchingEngine,
+                                 std::vector<Trade>& trades) {
+    OrderBook* orderBook = &getOrderBook(orders[0].symbol);
+    double tickSize = orderBook->getTickSize();
+    
+    // Queue orders for the database writer thread
+    for (size_t i = 0; i < count; ++i) {
+        orderLogger_.logOrder(orders[i], tickSize);
+    }
+    
+    // Match the orders
+    matchingEngine.submitOrders(orders, count, *orderBook, trades);
+    markSnapshotStale(orders[0].symbol);
+    
+    processTrades(trades, tickSize);
+    reportEngineActions(matchingEngine);
+    
+    // Tell owners about orders that ended without resting (IOC/FOK and market
+    // remainders, market orders during a call phase, self-trade prevention)
+    for (size_t i = 0; i < count; ++i) {
+        if (orders[i].status == OrderStatus::CANCELLED) {
+            onOrderCancelled(orders[i]);
+        }
+    }
+}
+
+bool MarketServer::enqueueControl(const std::string& symbol, ShardRequestType type) {
+    ShardRequest request;
+    request.type = type;
+    request.order.symbol = SymbolRegistry::instance().intern(symbol);
+    if (request.order.symbol == kInvalidSymbolId) {
+        return false;
+    }
+    return enqueueRequest(std::move(request));
+}
+
+bool MarketServer::startAuction(const std::string& symbol) {
+    return enqueueControl(symbol, ShardRequestType::START_AUCTION);
+}
+
+bool MarketServer::uncrossAuction(const std::string& symbol) {
+    return enqueueControl(symbol, ShardRequestType::UNCROSS);
+}
+
+bool MarketServer::endAuction(const std::string& symbol) {
+    return enqueueControl(symbol, ShardRequestType::END_AUCTION);
+}
+
+bool MarketServer::cancelOrder(const std::string& traderId, const std::string& symbol,
+                               OrderId orderId) {
+    SymbolId symbolId = SymbolRegistry::instance().find(symbol);
+    if (symbolId == kInvalidSymbolId) {
+        return false;
+    }
+    return enqueueCancel(traderId, symbolId, orderId);
+}
+
+bool MarketServer::replaceOrder(const std::string& traderId, const std::string& symbol,
+                                OrderId orderId, double price, double quantity) {
+    SymbolId symbolId = SymbolRegistry::instance().find(symbol);
+    Price ticks;
+    if (symbolId == kInvalidSymbolId || !priceToTicks(price, getTickSize(symbolId), ticks)) {
+        return false;
+    }
+    return enqueueReplace(traderId, symbolId, orderId, ticks, quantity);
+}
+
+bool MarketServer::enqueueCancel(const std::string& traderId, SymbolId symbol, OrderId orderId) {
+    ShardRequest request;
+    request.type = ShardRequestType::CANCEL;
+    request.order.traderId = traderId;
+    request.order.orderId = orderId;
+    request.order.symbol = symbol;
+    return enqueueRequest(std::move(request));
+}
+
+bool MarketServer::enqueueReplace(const std::string& traderId, SymbolId symbol, OrderId orderId,
+                                  Price price, double quantity) {
+    if (!std::isfinite(quantity) || !(quantity > 0) || price <= 0) {
+        return false;
+    }
+    ShardRequest request;
+    request.type = ShardRequestType::REPLACE;
+    request.order.traderId = traderId;
+    request.order.orderId = orderId;
+    request.order.symbol = symbol;
+    request.order.price = price;
+    request.order.quantity = quantity;
+    return enqueueRequest(std::move(request));
+}
+
+void MarketServer::executeControl(const ShardRequest& request, MatchingEngine& matchingEngine,
+                                  std::vector<Trade>& trades) {
+    OrderBook& orderBook = getOrderBook(request.order.symbol);
+    markSnapshotStale(request.order.symbol);
+    
+    if (request.type == ShardRequestType::CANCEL || request.type == ShardRequestType::REPLACE) {
+        // Only the owner may cancel or replace an order
+        const bool isCancel = (request.type == ShardRequestType::CANCEL);
+        const Order* existing = orderBook.getOrder(request.order.orderId);
+        if (!existing || existing->traderId != request.order.traderId) {
+            notifyTrader(request.order.traderId,
+                         std::string(isCancel ? "CANCEL_REJECTED:" : "REPLACE_REJECTED:") +
+                         formatOrderId(request.order.orderId) + ":Unknown order\n",
+                         binaryReject(BinaryRejectReason::UNKNOWN_ORDER, request.order));
+            return;
+        }
+        
+        Order order = *existing;
+        if (isCancel) {
+            orderBook.removeOrder(order.orderId);
+            order.status = OrderStatus::CANCELLED;
+            onOrderCancelled(order);
+            return;
+        }
+        
+        Order replaced;
+        if (!matchingEngine.replaceOrder(order.orderId, request.order.price, request.order.quantity,
+                                         orderBook, trades, &replaced)) {
+            notifyTrader(order.traderId, "REPLACE_REJECTED:" + orderReference(order) +
+                                         ":Invalid replace\n",
+                         binaryReject(BinaryRejectReason::INVALID_REPLACE, order));
+            return;
+        }
+        order.price = request.order.price;
+        order.quantity = request.order.quantity;
+        onOrderReplaced(order, orderBook.getTickSize());
+        processTrades(trades, orderBook.getTickSize());
+        reportEngineActions(matchingEngine);
+        // A crossing replace that self-trade prevention killed leaves the book
+        // without being an engine cancel; tell the owner it is gone
+        if (replaced.status == OrderStatus::CANCELLED) {
+            onOrderCancelled(replaced);
+        }
+        return;
     }
     
-    // Log order to database
-    orderLogger_.logOrder(order);
+    switch (request.type) {
+        case ShardRequestType::START_AUCTION:
+            orderBook.setTradingPhase(TradingPhase::CALL_AUCTION);
+            return;
+        case ShardRequestType::UNCROSS:
+            matchingEngine.uncross(orderBook, trades);
+            break;
+        case ShardRequestType::END_AUCTION:
+            matchingEngine.uncross(orderBook, trades);
+            orderBook.setTradingPhase(TradingPhase::CONTINUOUS);
+            break;
+        case ShardRequestType::ORDER:
+        case ShardRequestType::CANCEL:
+        case ShardRequestType::REPLACE:
+            return;
+    }
     
-    // Get or create order book
-    OrderBook* orderBook;
+    std::cout << "Auction uncross: " << orderBook.getSymbol()
+              << " | " << trades.size() << " trades" << std::endl;
+    processTrades(trades, orderBook.getTickSize());
+    reportEngineActions(matchingEngine);
+}
+
+void MarketServer::expireOrders(size_t shardIndex) {
+    uint64_t now = currentTimeMillis();
+    std::vector<Order> expired;
     {
+        // The worker is the only writer of these books; the lock only guards the list
         std::lock_guard<std::mutex> lock(orderBooksMutex_);
-        if (orderBooks_.find(order.symbol) == orderBooks_.end()) {
-            orderBooks_[order.symbol] = std::make_shared<OrderBook>(order.symbol);
+        for (OrderBook* orderBook : shardOrderBooks_[shardIndex]) {
+            if (orderBook->expireOrders(now, expired) > 0) {
+                markSnapshotStale(orderBook->getSymbolId());
+            }
         }
-        orderBook = orderBooks_[order.symbol].get();
+    }
+    for (const auto& order : expired) {
+        onOrderExpired(order);
+    }
+}
+
+void MarketServer::publishSnapshots(size_t shardIndex) {
+    // Only the top levels are copied every time; copying every order (and its
+    // trader ID) waits for a reader to ask, so it happens at the polling rate
+    std::lock_guard<std::mutex> lock(orderBooksMutex_);
+    for (OrderBook* orderBook : shardOrderBooks_[shardIndex]) {
+        SymbolId symbol = orderBook->getSymbolId();
+        bool copyOrders = false;
+        if (ordersWanted_[symbol].load(std::memory_order_relaxed) &&
+            ordersWanted_[symbol].exchange(false, std::memory_order_relaxed)) {
+            copyOrders = ordersStale_[symbol];
+        }
+        if (!snapshotStale_[symbol] && !copyOrders) {
+            continue;
+        }
+        
+        auto snapshot = std::make_shared<OrderBookSnapshot>(orderBook->takeSnapshot());
+        if (copyOrders) {
+            snapshot->orders = std::make_shared<const RestingOrdersSnapshot>(orderBook->takeOrdersSnapshot());
+            ordersStale_[symbol] = false;
+        } else if (auto previous = std::atomic_load(&snapshots_[symbol])) {
+            snapshot->orders = previous->orders;
+        }
+        snapshotStale_[symbol] = false;
+        std::atomic_store(&snapshots_[symbol], std::shared_ptr<const OrderBookSnapshot>(std::move(snapshot)));
+    }
+}
+
+void MarketServer::markSnapshotStale(SymbolId symbol) {
+    snapshotStale_[symbol] = true;
+    ordersStale_[symbol] = true;
+}
+
+void MarketServer::processTrades(const std::vector<Trade>& trades, double tickSize) {
+    if (trades.empty()) {
+        return;
     }
     
-    // Create a mutable copy for matching
-    Order mutableOrder = order;
-    
-    // Match the order
-    std::vector<Trade> trades = matchingEngine_.submitOrder(mutableOrder, *orderBook);
+    // Report and log trades
+    for (const auto& trade : trades) {
+        onTradeExecuted(trade);
+        orderLogger_.logTrade(trade, tickSize);
+    }
     
     // Settle trades
-    if (!trades.empty()) {
-        std::map<std::string, std::shared_ptr<Account>> accounts;
-        {
-            std::lock_guard<std::mutex> lock(accountsMutex_);
-            for (const auto& trade : trades) {
-                if (accounts.find(trade.buyTraderId) == accounts.end()) {
-                    auto trader = getTrader(trade.buyTraderId);
-                    if (trader) {
-                        accounts[trade.buyTraderId] = trader->getAccount();
-                    }
-                }
-                if (accounts.find(trade.sellTraderId) == accounts.end()) {
-                    auto trader = getTrader(trade.sellTraderId);
-                    if (trader) {
-                        accounts[trade.sellTraderId] = trader->getAccount();
-                    }
+    const TraderRegistry& traders = TraderRegistry::instance();
+    std::map<TraderKey, std::shared_ptr<Account>> accounts;
+    for (const auto& trade : trades) {
+        for (TraderKey traderKey : {trade.buyTraderKey, trade.sellTraderKey}) {
+            if (accounts.find(traderKey) == accounts.end()) {
+                auto trader = getTrader(traders.getTraderId(traderKey));
+                if (trader) {
+                    accounts[traderKey] = trader->getAccount();
                 }
             }
         }
-        
-        settlementEngine_.settleTrades(trades, accounts);
     }
     
-    return true;
+    settlementEngine_.settleTrades(trades, accounts, tickSize);
 }
 
 void MarketServer::registerTrader(std::shared_ptr<Trader> trader, std::shared_ptr<Account> account) {
@@ -344,12 +945,72 @@ void MarketServer::registerTrader(std::shared_ptr<Trader> trader, std::shared_pt
     accounts_[account->getAccountId()] = account;
 }
 
+void MarketServer::addOperator(const std::string& traderId) {
+    std::lock_guard<std::mutex> lock(tradersMutex_);
+    operators_.insert(traderId);
+}
+
 OrderBook& MarketServer::getOrderBook(const std::string& symbol) {
+    SymbolId symbolId = SymbolRegistry::instance().intern(symbol);
+    if (symbolId == kInvalidSymbolId) {
+        throw std::invalid_argument("Invalid symbol: " + symbol);
+    }
+    return getOrderBook(symbolId);
+}
+
+OrderBook& MarketServer::getOrderBook(SymbolId symbol) {
+    OrderBook* orderBook = orderBooks_[symbol].load(std::memory_order_acquire);
+    if (orderBook) {
+        return *orderBook;
+    }
+    std::lock_guard<std::mutex> lock(orderBooksMutex_);
+    return createOrderBook(symbol);
+}
+
+OrderBook& MarketServer::createOrderBook(SymbolId symbol) {
+    OrderBook* orderBook = orderBooks_[symbol].load(std::memory_order_acquire);
+    if (!orderBook) {
+        const SymbolConfig& config = symbolConfigs_[symbol];
+        ownedOrderBooks_.push_back(std::make_unique<OrderBook>(
+            SymbolRegistry::instance().getName(symbol), config.tickSize, config.bookMode));
+        orderBook = ownedOrderBooks_.back().get();
+        shardOrderBooks_[symbol % shards_.size()].push_back(orderBook);
+        orderBooks_[symbol].store(orderBook, std::memory_order_release);
+    }
+    return *orderBook;
+}
+
+void MarketServer::setTickSize(const std::string& symbol, double tickSize) {
     std::lock_guard<std::mutex> lock(orderBooksMutex_);
-    if (orderBooks_.find(symbol) == orderBooks_.end()) {
-        orderBooks_[symbol] = std::make_shared<OrderBook>(symbol);
+    symbolConfigs_[SymbolRegistry::instance().intern(symbol)].tickSize = tickSize;
+}
+
+void MarketServer::setBookMode(const std::string& symbol, BookMode mode) {
+    std::lock_guard<std::mutex> lock(orderBooksMutex_);
+    symbolConfigs_[SymbolRegistry::instance().intern(symbol)].bookMode = mode;
+}
+
+void MarketServer::setSlowConsumerPolicy(SlowConsumerPolicy policy, size_t maxOutboundBytes) {
+    for (auto& reactor : reactors_) {
+        reactor->setSlowConsumerPolicy(policy, maxOutboundBytes);
+    }
+}
+
+double MarketServer::getTickSize(const std::string& symbol) const {
+    return getTickSize(SymbolRegistry::instance().find(symbol));
+}
+
+double MarketServer::getTickSize(SymbolId symbol) const {
+    if (symbol >= kMaxSymbols) {
+        return kDefaultTickSize;
+    }
+    OrderBook* orderBook = orderBooks_[symbol].load(std::memory_order_acquire);
+    if (orderBook) {
+        return orderBook->getTickSize();
     }
-    return *orderBooks_[symbol];
+    std::lock_guard<std::mutex> lock(orderBooksMutex_);
+    auto configIt = symbolConfigs_.find(symbol);
+    return (configIt != symbolConfigs_.end()) ? configIt->second.tickSize : kDefaultTickSize;
 }
 
 std::shared_ptr<Trader> MarketServer::getTrader(const std::string& traderId) {
@@ -371,74 +1032,137 @@ std::shared_ptr<Account> MarketServer::getAccount(const std::string& accountId)
 }
 
 void MarketServer::onTradeExecuted(const Trade& trade) {
-    std::cout << "Trade executed: " << trade.tradeId 
-              << " | " << trade.symbol 
+    // Text is rendered here, at the edge; the trade itself holds only integers
+    double price = ticksToPrice(trade.price, getTickSize(trade.symbol));
+    const std::string& symbol = SymbolRegistry::instance().getName(trade.symbol);
+    const std::string tradeId = formatTradeId(trade.tradeId);
+    const std::string& buyTraderId = TraderRegistry::instance().getTraderId(trade.buyTraderKey);
+    const std::string& sellTraderId = TraderRegistry::instance().getTraderId(trade.sellTraderKey);
+    
+    std::cout << "Trade executed: " << tradeId 
+              << " | " << symbol 
               << " | " << trade.quantity 
-              << " @ " << trade.price 
-              << " | Buyer: " << trade.buyTraderId 
-              << " | Seller: " << trade.sellTraderId << std::endl;
+              << " @ " << price 
+              << " | Buyer: " << buyTraderId 
+              << " | Seller: " << sellTraderId << std::endl;
+    
+    BinaryFill fill = makeBinaryMessage<BinaryFill>();
+    fill.tradeId = trade.tradeId;
+    setBinarySymbol(fill.symbol, symbol);
+    fill.price = trade.price;
+    fill.quantity = trade.quantity;
     
     // Notify buyer
     {
-        std::lock_guard<std::mutex> lock(socketsMutex_);
-        auto buyIt = traderSockets_.find(trade.buyTraderId);
-        if (buyIt != traderSockets_.end()) {
-            std::ostringstream oss;
-            oss << "TRADE_EXECUTED:" << trade.tradeId 
-                << ":" << trade.symbol 
-                << ":BUY:" << trade.quantity 
-                << "@" << trade.price << "\n";
-            std::string msg = oss.str();
-            send(buyIt->second, msg.c_str(), msg.length(), 0);
-        }
+        std::ostringstream oss;
+        oss << "TRADE_EXECUTED:" << tradeId 
+            << ":" << symbol 
+            << ":BUY:" << trade.quantity 
+            << "@" << price << "\n";
+        fill.side = static_cast<uint8_t>(OrderSide::BUY);
+        fill.orderId = trade.buyOrderId;
+        notifyTrader(buyTraderId, oss.str(), encodeBinary(fill));
     }
     
     // Notify seller
+    {
+        std::ostringstream oss;
+        oss << "TRADE_EXECUTED:" << tradeId 
+            << ":" << symbol 
+            << ":SELL:" << trade.quantity 
+            << "@" << price << "\n";
+        fill.side = static_cast<uint8_t>(OrderSide::SELL);
+        fill.orderId = trade.sellOrderId;
+        notifyTrader(sellTraderId, oss.str(), encodeBinary(fill));
+    }
+}
+
+void MarketServer::onOrderCancelled(const Order& order) {
+    std::ostringstream oss;
+    oss << "ORDER_CANCELLED:" << orderReference(order)
+        << ":" << order.filledQuantity << "\n";
+    notifyTrader(order.traderId, oss.str(), binaryOrderDone(BinaryDoneReason::CANCELLED, order));
+}
+
+void MarketServer::onOrderReplaced(const Order& order, double tickSize) {
+    std::ostringstream oss;
+    oss << "ORDER_REPLACED:" << orderReference(order)
+        << ":" << ticksToPrice(order.price, tickSize)
+        << ":" << order.quantity << "\n";
+    BinaryReplaced replaced = makeBinaryMessage<BinaryReplaced>();
+    replaced.orderId = order.orderId;
+    replaced.clientOrderId = order.clientOrderId;
+    replaced.price = order.price;
+    replaced.quantity = order.quantity;
+    notifyTrader(order.traderId, oss.str(), encodeBinary(replaced));
+}
+
+void MarketServer::reportEngineActions(const MatchingEngine& matchingEngine) {
+    for (const auto& order : matchingEngine.getEngineCancels()) {
+        onOrderCancelled(order);
+    }
+    for (const auto& order : matchingEngine.getEngineAmends()) {
+        onOrderReplaced(order, getTickSize(order.symbol));
+    }
+}
+
+void MarketServer::onOrderExpired(const Order& order) {
+    std::ostringstream oss;
+    oss << "ORDER_EXPIRED:" << orderReference(order)
+        << ":" << order.filledQuantity << "\n";
+    notifyTrader(order.traderId, oss.str(), binaryOrderDone(BinaryDoneReason::EXPIRED, order));
+}
+
+void MarketServer::notifyTrader(const std::string& traderId, std::string message,
+                                std::string binaryMessage, uint64_t conflationKey) {
+    // Only the lookup is under the lock; the session's reactor does the writing
+    TraderConnection connection;
     {
         std::lock_guard<std::mutex> lock(socketsMutex_);
-        auto sellIt = traderSockets_.find(trade.sellTraderId);
-        if (sellIt != traderSockets_.end()) {
-            std::ostringstream oss;
-            oss << "TRADE_EXECUTED:" << trade.tradeId 
-                << ":" << trade.symbol 
-                << ":SELL:" << trade.quantity 
-                << "@" << trade.price << "\n";
-            std::string msg = oss.str();
-            send(sellIt->second, msg.c_str(), msg.length(), 0);
+        auto it = traderSockets_.find(traderId);
+        if (it == traderSockets_.end()) {
+            return;
         }
+        connection = it->second;
+    }
+    if (connection.protocol == Session::Protocol::TEXT) {
+        connection.outbox->send(std::move(message), conflationKey);
+    } else if (!binaryMessage.empty()) {
+        connection.outbox->send(std::move(binaryMessage), conflationKey);
     }
 }
 
 void MarketServer::onSettlementComplete(const std::string& traderId, 
-                                        const std::string& symbol,
+                                        SymbolId symbolId,
                                         double quantity, 
-                                        double price) {
+                                        double price,
+                                        double position) {
+    const std::string& symbol = SymbolRegistry::instance().getName(symbolId);
+    
     std::cout << "Settlement: Trader " << traderId 
               << " | " << symbol 
               << " | " << quantity 
               << " @ " << price << std::endl;
     
-    // Notify trader
-    {
-        std::lock_guard<std::mutex> lock(socketsMutex_);
-        auto it = traderSockets_.find(traderId);
-        if (it != traderSockets_.end()) {
-            std::ostringstream oss;
-            oss << "SETTLEMENT:" << symbol 
-                << ":" << quantity 
-                << "@" << price << "\n";
-            std::string msg = oss.str();
-            send(it->second, msg.c_str(), msg.length(), 0);
-        }
-    }
+    // Notify trader (text sessions only: a binary session's fills already say
+    // this). A slow consumer may have queued settlements conflated per symbol:
+    // the fill itself is always reported by TRADE_EXECUTED, and the position
+    // is cumulative, so the latest settlement left standing is still current.
+    std::ostringstream oss;
+    oss << "SETTLEMENT:" << symbol 
+        << ":" << quantity 
+        << "@" << price
+        << ":POSITION=" << position << "\n";
+    notifyTrader(traderId, oss.str(), std::string(), static_cast<uint64_t>(symbolId) + 1);
 }
 
 std::vector<std::string> MarketServer::getOrderBookSymbols() const {
     std::lock_guard<std::mutex> lock(orderBooksMutex_);
     std::vector<std::string> symbols;
-    for (const auto& pair : orderBooks_) {
-        symbols.push_back(pair.first);
+    for (const auto& orderBook : ownedOrderBooks_) {
+        symbols.push_back(orderBook->getSymbol());
     }
+    std::sort(symbols.begin(), symbols.end());
     return symbols;
 }
 
@@ -450,19 +1174,23 @@ int MarketServer::getConnectedTradersCount() const {
 int MarketServer::getTradersWithActiveOrdersCount() const {
     std::set<std::string> tradersWithOrders;
     
-    // Check all orderbooks for unique trader IDs
+    // Check the published snapshots for unique trader IDs (asking for fresh
+    // orders for the next call); the books themselves belong to the matching threads
+    std::vector<std::shared_ptr<const OrderBookSnapshot>> snapshots;
     {
         std::lock_guard<std::mutex> lock(orderBooksMutex_);
-        for (const auto& pair : orderBooks_) {
-            auto buyOrders = pair.second->getBuyOrders();
-            for (const auto& order : buyOrders) {
-                if (order.status == OrderStatus::PENDING || order.status == OrderStatus::PARTIALLY_FILLED) {
-                    tradersWithOrders.insert(order.traderId);
-                }
-            }
-            
-            auto sellOrders = pair.second->getSellOrders();
-            for (const auto& order : sellOrders) {
+        for (const auto& orderBook : ownedOrderBooks_) {
+            SymbolId symbol = orderBook->getSymbolId();
+            ordersWanted_[symbol].store(true, std::memory_order_relaxed);
+            snapshots.push_back(std::atomic_load(&snapshots_[symbol]));
+        }
+    }
+    for (const auto& snapshot : snapshots) {
+        if (!snapshot || !snapshot->orders) {
+            continue;
+        }
+        for (const auto* orders : {&snapshot->orders->buyOrders, &snapshot->orders->sellOrders}) {
+            for (const Order& order : *orders) {
                 if (order.status == OrderStatus::PENDING || order.status == OrderStatus::PARTIALLY_FILLED) {
                     tradersWithOrders.insert(order.traderId);
                 }
@@ -473,3 +1201,23 @@ int MarketServer::getTradersWithActiveOrdersCount() const {
     return static_cast<int>(tradersWithOrders.size());
 }
 
+std::shared_ptr<const OrderBookSnapshot> MarketServer::getOrderBookSnapshot(const std::string& symbol,
+                                                                          bool withOrders) const {
+    // Look up only: names from web requests must not use up symbol IDs
+    SymbolId symbolId = SymbolRegistry::instance().find(symbol);
+    if (symbolId == kInvalidSymbolId) {
+        return nullptr;
+    }
+    if (withOrders) {
+        ordersWanted_[symbolId].store(true, std::memory_order_relaxed);
+    }
+    auto snapshot = std::atomic_load(&snapshots_[symbolId]);
+    if (!snapshot) {
+        auto empty = std::make_shared<OrderBookSnapshot>();
+        empty->symbol = symbol;
+        empty->tickSize = getTickSize(symbolId);
+        snapshot = std::move(empty);
+    }
+    return snapshot;
+}
+
@@ -0,0 +1,107 @@
+#include "MatchingShard.h"
+#include <chrono>
+
+namespace {
+// Empty polls before the worker starts yielding, then sleeping
+constexpr int kSpinPolls = 256;
+constexpr int kYieldPolls = 1024;
+constexpr auto kIdleSleep = std::chrono::microseconds(50);
+}
+
+MatchingShard::MatchingShard(size_t shardIndex, size_t shardCount, OrderHandler orderHandler,
+                             ControlHandler controlHandler, MaintenanceHandler maintenanceHandler,
+                             size_t queueCapacity)
+    : queue_(queueCapacity), shardIndex_(shardIndex), matchingEngine_(shardIndex, shardCount),
+      orderHandler_(std::move(orderHandler)), controlHandler_(std::move(controlHandler)),
+      maintenanceHandler_(std::move(maintenanceHandler)), running_(false), batch_(kMaxShardBatch) {
+    orders_.reserve(kMaxShardBatch);
+}
+
+MatchingShard::~MatchingShard() {
+    stop();
+}
+
+void MatchingShard::start() {
+    if (running_) {
+        return;
+    }
+    running_ = true;
+    thread_ = std::thread(&MatchingShard::run, this);
+}
+
+void MatchingShard::stop() {
+    running_ = false;
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+}
+
+void MatchingShard::run() {
+    int idlePolls = 0;
+    while (true) {
+        maintain();
+        size_t count = drainBatch();
+        if (count > 0) {
+            idlePolls = 0;
+            dispatchBatch(count);
+            continue;
+        }
+        // Only exit once the queue is drained
+        if (!running_) {
+            break;
+        }
+        ++idlePolls;
+        if (idlePolls < kSpinPolls) {
+            continue;
+        } else if (idlePolls < kYieldPolls) {
+            std::this_thread::yield();
+        } else {
+            std::this_thread::sleep_for(kIdleSleep);
+        }
+    }
+}
+
+size_t MatchingShard::drainBatch() {
+    size_t count = 0;
+    while (count < batch_.size() && queue_.tryPop(batch_[count])) {
+        ++count;
+    }
+    return count;
+}
+
+void MatchingShard::dispatchBatch(size_t count) {
+    // Hand over runs of consecutive orders for the same symbol; arrival order
+    // within a symbol is preserved, and control requests run between runs
+    size_t begin = 0;
+    while (begin < count) {
+        trades_.clear();
+        if (batch_[begin].type != ShardRequestType::ORDER) {
+            controlHandler_(batch_[begin], matchingEngine_, trades_);
+            ++begin;
+            continue;
+        }
+
+        SymbolId symbol = batch_[begin].order.symbol;
+        orders_.clear();
+        size_t end = begin;
+        while (end < count && batch_[end].type == ShardRequestType::ORDER &&
+               batch_[end].order.symbol == symbol) {
+            orders_.push_back(std::move(batch_[end].order));
+            ++end;
+        }
+        orderHandler_(orders_.data(), orders_.size(), matchingEngine_, trades_);
+        begin = end;
+    }
+}
+
+void MatchingShard::maintain() {
+    if (!maintenanceHandler_) {
+        return;
+    }
+    auto now = std::chrono::steady_clock::now();
+    if (now < nextMaintenance_) {
+        return;
+    }
+    nextMaintenance_ = now + kShardMaintenanceInterval;
+    maintenanceHandler_(shardIndex_);
+}
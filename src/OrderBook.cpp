@@ -1,134 +1,474 @@
 #include "OrderBook.h"
 #include <algorithm>
+#include <cmath>
 
-OrderBook::OrderBook(const std::string& symbol) : symbol_(symbol) {
+namespace {
+constexpr size_t kInitialIndexSlots = 64;
+
+// Order IDs are sequential, so mix the bits before masking (splitmix64 finalizer)
+size_t hashOrderId(OrderId orderId) {
+    orderId ^= orderId >> 30;
+    orderId *= 0xbf58476d1ce4e5b9ULL;
+    orderId ^= orderId >> 27;
+    orderId *= 0x94d049bb133111ebULL;
+    orderId ^= orderId >> 31;
+    return static_cast<size_t>(orderId);
+}
+}
+
+OrderBook::OrderBook(const std::string& symbol, double tickSize, BookMode mode)
+    : symbol_(symbol), symbolId_(SymbolRegistry::instance().intern(symbol)), tickSize_(tickSize),
+      phase_(TradingPhase::CONTINUOUS),
+      memoryPool_(&allocationCounter_),
+      buyLevels_(true, mode, &memoryPool_), sellLevels_(false, mode, &memoryPool_),
+      buyStops_(&memoryPool_), sellStops_(&memoryPool_), lastTradePrice_(0),
+      expiryWheel_(currentTimeMillis()),
+      nodes_(&memoryPool_), orderIndex_(&memoryPool_), indexedOrders_(0) {
 }
 
 void OrderBook::addOrder(const Order& order) {
+    OrderHandle handle = allocateNode(order);
     if (order.side == OrderSide::BUY) {
-        buyOrders_[order.price].push_back(order);
-        indexOrder(order.orderId, order.price, buyOrders_[order.price].size() - 1, OrderSide::BUY);
+        linkBack(buyLevels_.getOrCreate(order.price), handle);
     } else {
-        sellOrders_[order.price].push_back(order);
-        indexOrder(order.orderId, order.price, sellOrders_[order.price].size() - 1, OrderSide::SELL);
+        linkBack(sellLevels_.getOrCreate(order.price), handle);
+    }
+    indexOrder(handle);
+    if (order.timeInForce == TimeInForce::GTD) {
+        expiryWheel_.schedule(order.orderId, order.expireTime);
     }
 }
 
-bool OrderBook::removeOrder(const std::string& orderId) {
-    auto it = orderIndex_.find(orderId);
-    if (it == orderIndex_.end()) {
+bool OrderBook::removeOrder(OrderId orderId) {
+    OrderHandle handle = findHandle(orderId);
+    if (handle == kInvalidOrderHandle) {
+        return removeStopOrder(orderId);
+    }
+
+    PriceLevels<PriceLevel>& levels =
+        (nodes_[handle].order.side == OrderSide::BUY) ? buyLevels_ : sellLevels_;
+    if (!removeFromLevels(levels, handle)) {
         return false;
     }
-    
-    double price = it->second.first;
-    size_t position = it->second.second;
-    
-    // Try to find in buy orders
-    auto buyIt = buyOrders_.find(price);
-    if (buyIt != buyOrders_.end() && position < buyIt->second.size()) {
-        if (buyIt->second[position].orderId == orderId) {
-            buyIt->second.erase(buyIt->second.begin() + position);
-            if (buyIt->second.empty()) {
-                buyOrders_.erase(buyIt);
-            } else {
-                // Reindex remaining orders at this price level
-                for (size_t i = position; i < buyIt->second.size(); ++i) {
-                    orderIndex_[buyIt->second[i].orderId] = {price, i};
-                }
-            }
-            orderIndex_.erase(it);
-            return true;
-        }
+
+    unindexOrder(handle);
+    releaseNode(handle);
+    return true;
+}
+
+bool OrderBook::amendOrder(OrderId orderId, Price price, double quantity) {
+    OrderHandle handle = findHandle(orderId);
+    if (handle == kInvalidOrderHandle) {
+        return false;
     }
-    
-    // Try to find in sell orders
-    auto sellIt = sellOrders_.find(price);
-    if (sellIt != sellOrders_.end() && position < sellIt->second.size()) {
-        if (sellIt->second[position].orderId == orderId) {
-            sellIt->second.erase(sellIt->second.begin() + position);
-            if (sellIt->second.empty()) {
-                sellOrders_.erase(sellIt);
-            } else {
-                // Reindex remaining orders at this price level
-                for (size_t i = position; i < sellIt->second.size(); ++i) {
-                    orderIndex_[sellIt->second[i].orderId] = {price, i};
-                }
-            }
-            orderIndex_.erase(it);
-            return true;
+    Order& order = nodes_[handle].order;
+    if (quantity <= order.filledQuantity) {
+        return false;
+    }
+    PriceLevels<PriceLevel>& levels = (order.side == OrderSide::BUY) ? buyLevels_ : sellLevels_;
+
+    if (price == order.price && quantity <= order.quantity) {
+        // Size-down: amend in place, keeping time priority
+        PriceLevel* level = levels.find(price);
+        if (!level) {
+            return false;
         }
+        double openBefore = order.quantity - order.filledQuantity;
+        double visibleBefore = order.visibleQuantity;
+        order.quantity = quantity;
+        double openQuantity = order.quantity - order.filledQuantity;
+        order.visibleQuantity = std::min(order.visibleQuantity, openQuantity);
+        level->totalQuantity += order.visibleQuantity - visibleBefore;
+        level->hiddenQuantity += (openQuantity - order.visibleQuantity) - (openBefore - visibleBefore);
+        return true;
     }
-    
-    return false;
+
+    // Re-price or size-up: relink the same record at the back of the target level
+    if (!removeFromLevels(levels, handle)) {
+        return false;
+    }
+    order.price = price;
+    order.quantity = quantity;
+    linkBack(levels.getOrCreate(price), handle);
+    return true;
 }
 
-double OrderBook::getBestBid() const {
-    if (buyOrders_.empty()) {
-        return 0.0;
+Price OrderBook::getBestBidTicks() const {
+    if (buyLevels_.empty()) {
+        return 0;
     }
-    return buyOrders_.begin()->first;
+    return buyLevels_.bestPrice();
 }
 
-double OrderBook::getBestAsk() const {
-    if (sellOrders_.empty()) {
-        return 0.0;
+Price OrderBook::getBestAskTicks() const {
+    if (sellLevels_.empty()) {
+        return 0;
     }
-    return sellOrders_.begin()->first;
+    return sellLevels_.bestPrice();
 }
 
 std::vector<Order> OrderBook::getBuyOrders() const {
     std::vector<Order> orders;
-    for (const auto& priceLevel : buyOrders_) {
-        for (const auto& order : priceLevel.second) {
-            orders.push_back(order);
-        }
-    }
+    orders.reserve(indexedOrders_);
+    forEachOrder(OrderSide::BUY, kNoLimit, [&](const Order& order) {
+        orders.push_back(order);
+        return true;
+    });
     return orders;
 }
 
 std::vector<Order> OrderBook::getSellOrders() const {
     std::vector<Order> orders;
-    for (const auto& priceLevel : sellOrders_) {
-        for (const auto& order : priceLevel.second) {
-            orders.push_back(order);
+    orders.reserve(indexedOrders_);
+    forEachOrder(OrderSide::SELL, kNoLimit, [&](const Order& order) {
+        orders.push_back(order);
+        return true;
+    });
+    return orders;
+}
+
+std::vector<LevelDepth> OrderBook::getDepth(OrderSide side, size_t nLevels) const {
+    std::vector<LevelDepth> depth;
+    depth.reserve(std::min(nLevels, levelsFor(side).levelCount()));
+    forEachLevel(side, nLevels, [&](const LevelDepth& level) {
+        depth.push_back(level);
+        return true;
+    });
+    return depth;
+}
+
+OrderBookSnapshot OrderBook::takeSnapshot(size_t depth) const {
+    OrderBookSnapshot snapshot;
+    snapshot.symbol = symbol_;
+    snapshot.tickSize = tickSize_;
+    snapshot.phase = phase_;
+    snapshot.bestBid = getBestBidTicks();
+    snapshot.bestAsk = getBestAskTicks();
+    if (phase_ == TradingPhase::CALL_AUCTION) {
+        snapshot.indicativeUncross = getIndicativeUncross();
+    }
+    snapshot.bids = getDepth(OrderSide::BUY, depth);
+    snapshot.asks = getDepth(OrderSide::SELL, depth);
+    return snapshot;
+}
+
+RestingOrdersSnapshot OrderBook::takeOrdersSnapshot() const {
+    RestingOrdersSnapshot snapshot;
+    snapshot.buyOrders = getBuyOrders();
+    snapshot.sellOrders = getSellOrders();
+    return snapshot;
+}
+
+void OrderBook::addStopOrder(const Order& order) {
+    if (order.side == OrderSide::BUY) {
+        buyStops_.emplace(order.stopPrice, order);
+    } else {
+        sellStops_.emplace(order.stopPrice, order);
+    }
+    if (order.timeInForce == TimeInForce::GTD) {
+        expiryWheel_.schedule(order.orderId, order.expireTime);
+    }
+}
+
+size_t OrderBook::expireOrders(uint64_t now, std::vector<Order>& expired) {
+    size_t count = 0;
+    expiryWheel_.advance(now, [&](OrderId orderId, uint64_t expireTime) {
+        const Order* order = getOrder(orderId);
+        if (!order || order->expireTime != expireTime) {
+            return; // Filled, cancelled, or fired twice after a stop triggered
         }
+        expired.push_back(*order);
+        expired.back().status = OrderStatus::CANCELLED;
+        removeOrder(orderId);
+        ++count;
+    });
+    return count;
+}
+
+void OrderBook::popTriggeredStops(Price low, Price high, std::vector<Order>& out) {
+    if (high == 0) {
+        return;
     }
-    return orders;
+    auto buyEnd = buyStops_.upper_bound(high);
+    for (auto it = buyStops_.begin(); it != buyEnd; ++it) {
+        out.push_back(std::move(it->second));
+    }
+    buyStops_.erase(buyStops_.begin(), buyEnd);
+
+    auto sellEnd = sellStops_.upper_bound(low);
+    for (auto it = sellStops_.begin(); it != sellEnd; ++it) {
+        out.push_back(std::move(it->second));
+    }
+    sellStops_.erase(sellStops_.begin(), sellEnd);
+}
+
+AuctionQuote OrderBook::getIndicativeUncross() const {
+    AuctionQuote quote{0, 0.0, 0.0};
+    if (buyLevels_.empty() || sellLevels_.empty()) {
+        return quote;
+    }
+    Price bestBid = buyLevels_.bestPrice();
+    Price bestAsk = sellLevels_.bestPrice();
+    if (bestBid < bestAsk) {
+        return quote;
+    }
+
+    // Only levels inside the crossed range [bestAsk, bestBid] can execute;
+    // iceberg reserves take part in full
+    std::vector<LevelDepth> bids; // Descending
+    std::vector<LevelDepth> asks; // Ascending
+    double buyVolume = 0.0;
+    forEachLevel(OrderSide::BUY, kNoLimit, [&](const LevelDepth& level) {
+        if (level.price < bestAsk) return false;
+        bids.push_back(level);
+        buyVolume += level.quantity + level.hiddenQuantity;
+        return true;
+    });
+    forEachLevel(OrderSide::SELL, kNoLimit, [&](const LevelDepth& level) {
+        if (level.price > bestBid) return false;
+        asks.push_back(level);
+        return true;
+    });
+
+    // Sweep candidate prices upwards: buy volume at or above the price shrinks,
+    // sell volume at or below it grows. Volumes are constant between level
+    // prices, so only level prices need checking.
+    double sellVolume = 0.0;
+    auto bid = bids.rbegin();
+    auto ask = asks.begin();
+    Price tieLow = 0;
+    Price tieHigh = 0;
+    bool found = false;
+    while (bid != bids.rend() || ask != asks.end()) {
+        Price price = (ask == asks.end() || (bid != bids.rend() && bid->price < ask->price))
+                          ? bid->price : ask->price;
+        while (ask != asks.end() && ask->price == price) {
+            sellVolume += ask->quantity + ask->hiddenQuantity;
+            ++ask;
+        }
+
+        double volume = std::min(buyVolume, sellVolume);
+        double surplus = std::fabs(buyVolume - sellVolume);
+        if (!found || volume > quote.volume ||
+            (volume == quote.volume && surplus < quote.surplus)) {
+            quote.volume = volume;
+            quote.surplus = surplus;
+            tieLow = tieHigh = price;
+            found = true;
+        } else if (volume == quote.volume && surplus == quote.surplus) {
+            tieHigh = price;
+        }
+
+        // Bids at this price no longer count above it
+        while (bid != bids.rend() && bid->price == price) {
+            buyVolume -= bid->quantity + bid->hiddenQuantity;
+            ++bid;
+        }
+    }
+
+    quote.price = tieLow + (tieHigh - tieLow) / 2;
+    return quote;
+}
+
+const Order* OrderBook::getOrder(OrderId orderId) const {
+    OrderHandle handle = findHandle(orderId);
+    if (handle != kInvalidOrderHandle) {
+        return &nodes_[handle].order;
+    }
+    // Untriggered stops are not indexed; lookups that miss the index are rare
+    // (cancels and amends), so a scan is enough
+    for (const auto& entry : buyStops_) {
+        if (entry.second.orderId == orderId) return &entry.second;
+    }
+    for (const auto& entry : sellStops_) {
+        if (entry.second.orderId == orderId) return &entry.second;
+    }
+    return nullptr;
 }
 
-Order* OrderBook::getOrder(const std::string& orderId) {
-    auto it = orderIndex_.find(orderId);
-    if (it == orderIndex_.end()) {
+const Order* OrderBook::bestOrder(OrderSide side) const {
+    const PriceLevel* level = (side == OrderSide::BUY) ? buyLevels_.bestLevel() : sellLevels_.bestLevel();
+    if (!level) {
         return nullptr;
     }
-    
-    double price = it->second.first;
-    size_t position = it->second.second;
-    
-    // Try buy orders
-    auto buyIt = buyOrders_.find(price);
-    if (buyIt != buyOrders_.end() && position < buyIt->second.size()) {
-        if (buyIt->second[position].orderId == orderId) {
-            return &buyIt->second[position];
+    return &nodes_[level->head].order;
+}
+
+void OrderBook::fillBestOrder(OrderSide side, double quantity) {
+    PriceLevels<PriceLevel>& levels = (side == OrderSide::BUY) ? buyLevels_ : sellLevels_;
+    PriceLevel* level = levels.bestLevel();
+    if (!level) {
+        return;
+    }
+    OrderHandle handle = level->head;
+    Order& order = nodes_[handle].order;
+    order.filledQuantity += quantity;
+    order.visibleQuantity -= quantity;
+    level->totalQuantity -= quantity;
+    if (order.filledQuantity >= order.quantity) {
+        order.status = OrderStatus::FILLED;
+        popBestOrder(side);
+        return;
+    }
+    order.status = OrderStatus::PARTIALLY_FILLED;
+    if (order.visibleQuantity <= 0) {
+        // Iceberg slice used up: show the next slice, losing time priority
+        unlink(*level, handle);
+        linkBack(*level, handle);
+    }
+}
+
+void OrderBook::popBestOrder(OrderSide side) {
+    PriceLevels<PriceLevel>& levels = (side == OrderSide::BUY) ? buyLevels_ : sellLevels_;
+    PriceLevel* level = levels.bestLevel();
+    if (!level) {
+        return;
+    }
+    OrderHandle handle = level->head;
+    unindexOrder(handle);
+    unlink(*level, handle);
+    if (level->head == kInvalidOrderHandle) {
+        levels.erase(nodes_[handle].order.price);
+    }
+    releaseNode(handle);
+}
+
+OrderHandle OrderBook::allocateNode(const Order& order) {
+    OrderHandle handle = nodes_.allocate();
+    OrderNode& node = nodes_[handle];
+    node.order = order;
+    node.prev = kInvalidOrderHandle;
+    node.next = kInvalidOrderHandle;
+    return handle;
+}
+
+void OrderBook::releaseNode(OrderHandle handle) {
+    nodes_.release(handle);
+}
+
+OrderHandle OrderBook::findHandle(OrderId orderId) const {
+    if (orderIndex_.empty()) {
+        return kInvalidOrderHandle;
+    }
+    size_t mask = orderIndex_.size() - 1;
+    for (size_t slot = hashOrderId(orderId) & mask; ; slot = (slot + 1) & mask) {
+        OrderHandle handle = orderIndex_[slot];
+        if (handle == kInvalidOrderHandle || nodes_[handle].order.orderId == orderId) {
+            return handle;
+        }
+    }
+}
+
+void OrderBook::indexOrder(OrderHandle handle) {
+    // Keep the load factor at or below one half
+    if ((indexedOrders_ + 1) * 2 > orderIndex_.size()) {
+        growIndex();
+    }
+    size_t mask = orderIndex_.size() - 1;
+    size_t slot = hashOrderId(nodes_[handle].order.orderId) & mask;
+    while (orderIndex_[slot] != kInvalidOrderHandle) {
+        slot = (slot + 1) & mask;
+    }
+    orderIndex_[slot] = handle;
+    ++indexedOrders_;
+}
+
+void OrderBook::unindexOrder(OrderHandle handle) {
+    size_t mask = orderIndex_.size() - 1;
+    size_t hole = hashOrderId(nodes_[handle].order.orderId) & mask;
+    while (orderIndex_[hole] != handle) {
+        hole = (hole + 1) & mask;
+    }
+
+    // Backward-shift deletion: pull later entries of the probe run into the hole
+    for (size_t slot = (hole + 1) & mask; orderIndex_[slot] != kInvalidOrderHandle;
+         slot = (slot + 1) & mask) {
+        size_t home = hashOrderId(nodes_[orderIndex_[slot]].order.orderId) & mask;
+        if (((slot - home) & mask) >= ((slot - hole) & mask)) {
+            orderIndex_[hole] = orderIndex_[slot];
+            hole = slot;
         }
     }
-    
-    // Try sell orders
-    auto sellIt = sellOrders_.find(price);
-    if (sellIt != sellOrders_.end() && position < sellIt->second.size()) {
-        if (sellIt->second[position].orderId == orderId) {
-            return &sellIt->second[position];
+    orderIndex_[hole] = kInvalidOrderHandle;
+    --indexedOrders_;
+}
+
+void OrderBook::growIndex() {
+    size_t newSize = orderIndex_.empty() ? kInitialIndexSlots : orderIndex_.size() * 2;
+    std::pmr::vector<OrderHandle> oldIndex(newSize, kInvalidOrderHandle, orderIndex_.get_allocator());
+    oldIndex.swap(orderIndex_);
+    indexedOrders_ = 0;
+    for (OrderHandle handle : oldIndex) {
+        if (handle != kInvalidOrderHandle) {
+            indexOrder(handle);
         }
     }
-    
-    return nullptr;
 }
 
-void OrderBook::indexOrder(const std::string& orderId, double price, size_t position, OrderSide side) {
-    orderIndex_[orderId] = {price, position};
+void OrderBook::linkBack(PriceLevel& level, OrderHandle handle) {
+    OrderNode& node = nodes_[handle];
+    double openQuantity = node.order.quantity - node.order.filledQuantity;
+    node.order.visibleQuantity = (node.order.displayQuantity > 0)
+                                     ? std::min(node.order.displayQuantity, openQuantity)
+                                     : openQuantity;
+    level.totalQuantity += node.order.visibleQuantity;
+    level.hiddenQuantity += openQuantity - node.order.visibleQuantity;
+    ++level.orderCount;
+    node.prev = level.tail;
+    node.next = kInvalidOrderHandle;
+    if (level.tail != kInvalidOrderHandle) {
+        nodes_[level.tail].next = handle;
+    } else {
+        level.head = handle;
+    }
+    level.tail = handle;
+}
+
+void OrderBook::unlink(PriceLevel& level, OrderHandle handle) {
+    OrderNode& node = nodes_[handle];
+    double openQuantity = node.order.quantity - node.order.filledQuantity;
+    level.totalQuantity -= node.order.visibleQuantity;
+    level.hiddenQuantity -= openQuantity - node.order.visibleQuantity;
+    --level.orderCount;
+    if (node.prev != kInvalidOrderHandle) {
+        nodes_[node.prev].next = node.next;
+    } else {
+        level.head = node.next;
+    }
+    if (node.next != kInvalidOrderHandle) {
+        nodes_[node.next].prev = node.prev;
+    } else {
+        level.tail = node.prev;
+    }
+    node.prev = kInvalidOrderHandle;
+    node.next = kInvalidOrderHandle;
 }
 
-void OrderBook::removeFromIndex(const std::string& orderId) {
-    orderIndex_.erase(orderId);
+bool OrderBook::removeFromLevels(PriceLevels<PriceLevel>& levels, OrderHandle handle) {
+    Price price = nodes_[handle].order.price;
+    PriceLevel* level = levels.find(price);
+    if (!level) {
+        return false;
+    }
+    unlink(*level, handle);
+    if (level->head == kInvalidOrderHandle) {
+        levels.erase(price);
+    }
+    return true;
 }
 
+bool OrderBook::removeStopOrder(OrderId orderId) {
+    for (auto it = buyStops_.begin(); it != buyStops_.end(); ++it) {
+        if (it->second.orderId == orderId) {
+            buyStops_.erase(it);
+            return true;
+        }
+    }
+    for (auto it = sellStops_.begin(); it != sellStops_.end(); ++it) {
+        if (it->second.orderId == orderId) {
+            sellStops_.erase(it);
+            return true;
+        }
+    }
+    return false;
+}
@@ -7,9 +7,10 @@
 #include <cstring>
 #include <cstdlib>
 #include <mutex>
+#include <thread>
 
 OrderLogger::OrderLogger(const std::string& connectionString)
-    : connectionString_(connectionString), conn_(nullptr) {
+    : connectionString_(connectionString), conn_(nullptr), running_(false), dropped_(0) {
     // If connection string is empty, try to build from environment variables
     if (connectionString_.empty()) {
         std::ostringstream envConnStr;
@@ -117,6 +118,10 @@ bool OrderLogger::initialize() {
     executeQuery("CREATE INDEX IF NOT EXISTS idx_trades_buyer ON trades(buyer_id)");
     executeQuery("CREATE INDEX IF NOT EXISTS idx_trades_seller ON trades(seller_id)");
     
+    queue_ = std::make_unique<MpscQueue<LogRecord>>(kLogQueueCapacity);
+    running_ = true;
+    writerThread_ = std::thread(&OrderLogger::runWriter, this);
+    
     std::cout << "Order logger initialized: Connected to PostgreSQL database" << std::endl;
     return true;
     } catch (const std::exception& e) {
@@ -164,9 +169,83 @@ std::string OrderLogger::escapeString(const std::string& str) {
     return result;
 }
 
-bool OrderLogger::logOrder(const Order& order) {
-    std::lock_guard<std::mutex> lock(connMutex_);
+bool OrderLogger::logOrder(const Order& order, double tickSize) {
+    LogRecord record;
+    record.order = order;
+    record.tickSize = tickSize;
+    return enqueue(std::move(record));
+}
+
+bool OrderLogger::logTrade(const Trade& trade, double tickSize) {
+    LogRecord record;
+    record.isTrade = true;
+    record.trade = trade;
+    record.tickSize = tickSize;
+    return enqueue(std::move(record));
+}
+
+bool OrderLogger::enqueue(LogRecord&& record) {
+    if (!running_) {
+        return false;
+    }
+    if (!queue_->tryPush(std::move(record))) {
+        ++dropped_; // Never stall the caller (a matching thread) on the database
+        return false;
+    }
+    return true;
+}
+
+void OrderLogger::runWriter() {
+    std::vector<LogRecord> batch;
+    batch.reserve(kMaxLogBatch);
+    LogRecord record;
+    while (true) {
+        batch.clear();
+        while (batch.size() < kMaxLogBatch && queue_->tryPop(record)) {
+            batch.push_back(std::move(record));
+        }
+        if (!batch.empty()) {
+            std::lock_guard<std::mutex> lock(connMutex_);
+            writeBatch(batch);
+            continue;
+        }
+        // Only exit once the queue is drained
+        if (!running_) {
+            break;
+        }
+        std::this_thread::sleep_for(kLogIdleSleep);
+    }
+}
+
+void OrderLogger::writeBatch(const std::vector<LogRecord>& records) {
+    PGconn* conn = static_cast<PGconn*>(conn_);
+    if (!conn || PQstatus(conn) != CONNECTION_OK) {
+        return;
+    }
+    auto writeAll = [&]() {
+        bool success = true;
+        for (const LogRecord& record : records) {
+            success &= record.isTrade ? writeTrade(record.trade, record.tickSize)
+                                      : writeOrder(record.order, record.tickSize);
+        }
+        return success;
+    };
+    auto command = [conn](const char* sql) {
+        PGresult* res = PQexec(conn, sql);
+        bool success = res && PQresultStatus(res) == PGRES_COMMAND_OK;
+        PQclear(res);
+        return success;
+    };
     
+    if (command("BEGIN") && writeAll() && command("COMMIT")) {
+        return;
+    }
+    // One bad record aborts the whole transaction: write them one by one instead
+    command("ROLLBACK");
+    writeAll();
+}
+
+bool OrderLogger::writeOrder(const Order& order, double tickSize) {
     if (!conn_) {
         return false;
     }
@@ -201,11 +280,26 @@ bool OrderLogger::logOrder(const Order& order) {
             statusStr = "UNKNOWN";
     }
     
+    std::string orderIdStr = formatOrderId(order.orderId);
+    const std::string& symbolName = SymbolRegistry::instance().getName(order.symbol);
     std::string sideStr = (order.side == OrderSide::BUY) ? "BUY" : "SELL";
-    std::string typeStr = (order.type == OrderType::MARKET) ? "MARKET" : "LIMIT";
+    std::string typeStr;
+    switch (order.type) {
+        case OrderType::MARKET:
+            typeStr = "MARKET";
+            break;
+        case OrderType::STOP:
+            typeStr = "STOP";
+            break;
+        case OrderType::STOP_LIMIT:
+            typeStr = "STOP_LIMIT";
+            break;
+        default:
+            typeStr = "LIMIT";
+    }
     
     // Convert numbers to strings for parameters (must stay alive during query execution)
-    std::string priceStr = std::to_string(order.price);
+    std::string priceStr = std::to_string(ticksToPrice(order.price, tickSize));
     std::string quantityStr = std::to_string(order.quantity);
     std::string filledStr = std::to_string(order.filledQuantity);
     std::string timestampStr = std::to_string(timestamp);
@@ -220,9 +314,9 @@ bool OrderLogger::logOrder(const Order& order) {
     
     // Set up parameter values (all strings must remain valid during PQexecParams)
     const char* paramValues[10] = {
-        order.orderId.c_str(),
+        orderIdStr.c_str(),
         order.traderId.c_str(),
-        order.symbol.c_str(),
+        symbolName.c_str(),
         sideStr.c_str(),
         typeStr.c_str(),
         priceStr.c_str(),
@@ -233,9 +327,9 @@ bool OrderLogger::logOrder(const Order& order) {
     };
     
     int paramLengths[10] = {
-        static_cast<int>(order.orderId.length()),
+        static_cast<int>(orderIdStr.length()),
         static_cast<int>(order.traderId.length()),
-        static_cast<int>(order.symbol.length()),
+        static_cast<int>(symbolName.length()),
         static_cast<int>(sideStr.length()),
         static_cast<int>(typeStr.length()),
         static_cast<int>(priceStr.length()),
@@ -269,17 +363,15 @@ bool OrderLogger::logOrder(const Order& order) {
     PQclear(res);
     return success;
     } catch (const std::exception& e) {
-        std::cerr << "Exception in logOrder: " << e.what() << std::endl;
+        std::cerr << "Exception in writeOrder: " << e.what() << std::endl;
         return false;
     } catch (...) {
-        std::cerr << "Unknown exception in logOrder" << std::endl;
+        std::cerr << "Unknown exception in writeOrder" << std::endl;
         return false;
     }
 }
 
-bool OrderLogger::logTrade(const Trade& trade) {
-    std::lock_guard<std::mutex> lock(connMutex_);
-    
+bool OrderLogger::writeTrade(const Trade& trade, double tickSize) {
     if (!conn_) {
         return false;
     }
@@ -296,7 +388,13 @@ bool OrderLogger::logTrade(const Trade& trade) {
     ).count();
     
     // Convert numbers to strings for parameters (must stay alive during query execution)
-    std::string priceStr = std::to_string(trade.price);
+    std::string tradeIdStr = formatTradeId(trade.tradeId);
+    std::string buyOrderIdStr = formatOrderId(trade.buyOrderId);
+    std::string sellOrderIdStr = formatOrderId(trade.sellOrderId);
+    const std::string& symbolName = SymbolRegistry::instance().getName(trade.symbol);
+    const std::string& buyTraderId = TraderRegistry::instance().getTraderId(trade.buyTraderKey);
+    const std::string& sellTraderId = TraderRegistry::instance().getTraderId(trade.sellTraderKey);
+    std::string priceStr = std::to_string(ticksToPrice(trade.price, tickSize));
     std::string quantityStr = std::to_string(trade.quantity);
     std::string timestampStr = std::to_string(timestamp);
     
@@ -307,24 +405,24 @@ bool OrderLogger::logTrade(const Trade& trade) {
     
     // Set up parameter values (all strings must remain valid during PQexecParams)
     const char* paramValues[9] = {
-        trade.tradeId.c_str(),
-        trade.buyOrderId.c_str(),
-        trade.sellOrderId.c_str(),
-        trade.symbol.c_str(),
-        trade.buyTraderId.c_str(),
-        trade.sellTraderId.c_str(),
+        tradeIdStr.c_str(),
+        buyOrderIdStr.c_str(),
+        sellOrderIdStr.c_str(),
+        symbolName.c_str(),
+        buyTraderId.c_str(),
+        sellTraderId.c_str(),
         priceStr.c_str(),
         quantityStr.c_str(),
         timestampStr.c_str()
     };
     
     int paramLengths[9] = {
-        static_cast<int>(trade.tradeId.length()),
-        static_cast<int>(trade.buyOrderId.length()),
-        static_cast<int>(trade.sellOrderId.length()),
-        static_cast<int>(trade.symbol.length()),
-        static_cast<int>(trade.buyTraderId.length()),
-        static_cast<int>(trade.sellTraderId.length()),
+        static_cast<int>(tradeIdStr.length()),
+        static_cast<int>(buyOrderIdStr.length()),
+        static_cast<int>(sellOrderIdStr.length()),
+        static_cast<int>(symbolName.length()),
+        static_cast<int>(buyTraderId.length()),
+        static_cast<int>(sellTraderId.length()),
         static_cast<int>(priceStr.length()),
         static_cast<int>(quantityStr.length()),
         static_cast<int>(timestampStr.length())
@@ -354,10 +452,10 @@ bool OrderLogger::logTrade(const Trade& trade) {
     PQclear(res);
     return success;
     } catch (const std::exception& e) {
-        std::cerr << "Exception in logTrade: " << e.what() << std::endl;
+        std::cerr << "Exception in writeTrade: " << e.what() << std::endl;
         return false;
     } catch (...) {
-        std::cerr << "Unknown exception in logTrade" << std::endl;
+        std::cerr << "Unknown exception in writeTrade" << std::endl;
         return false;
     }
 }
@@ -400,6 +498,14 @@ bool OrderLogger::executeQuery(const std::string& query) {
 }
 
 void OrderLogger::close() {
+    running_ = false;
+    if (writerThread_.joinable()) {
+        writerThread_.join();
+        if (dropped_ > 0) {
+            std::cerr << "Order logger dropped " << dropped_ << " records" << std::endl;
+        }
+    }
+    
     std::lock_guard<std::mutex> lock(connMutex_);
     
     if (conn_) {
@@ -0,0 +1,231 @@
+#include "OrderParser.h"
+#include "TimerWheel.h"
+#include <charconv>
+#include <cmath>
+
+namespace {
+// Walks the ':'-separated fields of a message without copying them
+class FieldReader {
+public:
+    explicit FieldReader(std::string_view text) : text_(text), done_(false) {}
+
+    bool next(std::string_view& field) {
+        if (done_) {
+            return false;
+        }
+        size_t separator = text_.find(':');
+        field = text_.substr(0, separator);
+        if (separator == std::string_view::npos) {
+            done_ = true;
+        } else {
+            text_.remove_prefix(separator + 1);
+        }
+        return true;
+    }
+
+private:
+    std::string_view text_;
+    bool done_;
+};
+
+// The whole of text as a number (no locale, no leading '+' or whitespace)
+template <typename T>
+bool parseNumber(std::string_view text, T& value) {
+    const char* end = text.data() + text.size();
+    auto result = std::from_chars(text.data(), end, value);
+    return result.ec == std::errc() && result.ptr == end;
+}
+
+bool parsePositive(std::string_view text, double& value) {
+    return parseNumber(text, value) && std::isfinite(value) && value > 0;
+}
+
+bool parsePrice(std::string_view text, double tickSize, Price& ticks) {
+    double price;
+    return parseNumber(text, price) && std::isfinite(price) && price >= 0 &&
+           priceToTicks(price, tickSize, ticks);
+}
+}
+
+OrderRejectReason parseOrderMessage(std::string_view message, Order& order,
+                                    const TickSizeLookup& tickSizeOf) {
+    OrderRejectReason reason = OrderRejectReason::NONE;
+    auto reject = [&reason](OrderRejectReason problem) {
+        if (reason == OrderRejectReason::NONE) {
+            reason = problem;
+        }
+    };
+
+    // Required fields: traderId, symbol, side, type, price, quantity
+    constexpr std::string_view kPrefix = "ORDER:";
+    bool hasPrefix = (message.compare(0, kPrefix.size(), kPrefix) == 0);
+    FieldReader reader(hasPrefix ? message.substr(kPrefix.size()) : std::string_view());
+    std::string_view fields[6];
+    for (std::string_view& field : fields) {
+        if (!hasPrefix || !reader.next(field) || field.empty()) {
+            order.status = OrderStatus::REJECTED;
+            order.rejectReason = OrderRejectReason::MALFORMED;
+            return OrderRejectReason::MALFORMED;
+        }
+    }
+
+    order.traderId.assign(fields[0].data(), fields[0].size());
+    order.traderKey = TraderRegistry::instance().intern(order.traderId);
+
+    order.symbol = SymbolRegistry::instance().intern(std::string(fields[1]));
+    double tickSize = kDefaultTickSize;
+    if (order.symbol == kInvalidSymbolId) {
+        reject(OrderRejectReason::UNKNOWN_SYMBOL);
+    } else {
+        tickSize = tickSizeOf(order.symbol);
+    }
+
+    if (fields[2] == "BUY") {
+        order.side = OrderSide::BUY;
+    } else if (fields[2] == "SELL") {
+        order.side = OrderSide::SELL;
+    } else {
+        reject(OrderRejectReason::INVALID_SIDE);
+    }
+
+    if (fields[3] == "LIMIT") {
+        order.type = OrderType::LIMIT;
+    } else if (fields[3] == "MARKET") {
+        order.type = OrderType::MARKET;
+    } else if (fields[3] == "STOP") {
+        order.type = OrderType::STOP;
+    } else if (fields[3] == "STOP_LIMIT") {
+        order.type = OrderType::STOP_LIMIT;
+    } else {
+        reject(OrderRejectReason::INVALID_TYPE);
+    }
+
+    if (!parsePrice(fields[4], tickSize, order.price) ||
+        (order.price <= 0 && (order.type == OrderType::LIMIT || order.type == OrderType::STOP_LIMIT))) {
+        reject(OrderRejectReason::INVALID_PRICE); // Includes prices off the tick grid
+    }
+    if (!parsePositive(fields[5], order.quantity)) {
+        reject(OrderRejectReason::INVALID_QUANTITY);
+    }
+
+    // Optional KEY=VALUE fields
+    std::string_view field;
+    while (reader.next(field)) {
+        if (field.empty()) {
+            continue; // Tolerate a trailing ':'
+        }
+        size_t equals = field.find('=');
+        std::string_view key = field.substr(0, equals);
+        std::string_view value = (equals == std::string_view::npos) ? std::string_view()
+                                                                    : field.substr(equals + 1);
+        bool valid = true;
+        if (key == "CLID") {
+            valid = parseNumber(value, order.clientOrderId);
+        } else if (key == "TIF") {
+            if (value == "GTC") {
+                order.timeInForce = TimeInForce::GTC;
+            } else if (value == "IOC") {
+                order.timeInForce = TimeInForce::IOC;
+            } else if (value == "FOK") {
+                order.timeInForce = TimeInForce::FOK;
+            } else if (value == "GTD") {
+                order.timeInForce = TimeInForce::GTD;
+            } else {
+                valid = false;
+            }
+        } else if (key == "STP") {
+            if (value == "CANCEL_NEWEST") {
+                order.selfTradePrevention = SelfTradePrevention::CANCEL_NEWEST;
+            } else if (value == "CANCEL_OLDEST") {
+                order.selfTradePrevention = SelfTradePrevention::CANCEL_OLDEST;
+            } else if (value == "DECREMENT_BOTH") {
+                order.selfTradePrevention = SelfTradePrevention::DECREMENT_BOTH;
+            } else {
+                valid = false;
+            }
+        } else if (key == "EXPIRE") {
+            valid = parseNumber(value, order.expireTime);
+        } else if (key == "DISPLAY") {
+            valid = parsePositive(value, order.displayQuantity);
+        } else if (key == "STOP") {
+            if (!parsePrice(value, tickSize, order.stopPrice) || order.stopPrice <= 0) {
+                reject(OrderRejectReason::INVALID_PRICE);
+            }
+        } else {
+            valid = false;
+        }
+        if (!valid) {
+            reject(OrderRejectReason::INVALID_FIELD);
+        }
+    }
+
+    if (!hasConsistentOrderFields(order)) {
+        reject(OrderRejectReason::INCONSISTENT_FIELDS);
+    }
+
+    if (reason != OrderRejectReason::NONE) {
+        order.status = OrderStatus::REJECTED;
+        order.rejectReason = reason;
+    }
+    return reason;
+}
+
+OrderRejectReason parseCancelReplaceMessage(std::string_view message, CancelReplaceRequest& request,
+                                            const TickSizeLookup& tickSizeOf) {
+    constexpr std::string_view kCancelPrefix = "CANCEL:";
+    constexpr std::string_view kReplacePrefix = "REPLACE:";
+    request.isCancel = (message.compare(0, kCancelPrefix.size(), kCancelPrefix) == 0);
+    bool isReplace = (message.compare(0, kReplacePrefix.size(), kReplacePrefix) == 0);
+    if (!request.isCancel && !isReplace) {
+        return OrderRejectReason::MALFORMED;
+    }
+
+    // Exactly traderId, symbol, orderId (and for a replace price, quantity)
+    FieldReader reader(message.substr(request.isCancel ? kCancelPrefix.size() : kReplacePrefix.size()));
+    std::string_view fields[5];
+    size_t fieldCount = request.isCancel ? 3 : 5;
+    for (size_t i = 0; i < fieldCount; ++i) {
+        if (!reader.next(fields[i]) || fields[i].empty()) {
+            return OrderRejectReason::MALFORMED;
+        }
+    }
+    std::string_view extra;
+    std::string_view orderId = fields[2];
+    if (orderId.compare(0, 4, "ORD_") == 0) {
+        orderId.remove_prefix(4);
+    }
+    if (reader.next(extra) || !parseNumber(orderId, request.orderId)) {
+        return OrderRejectReason::MALFORMED;
+    }
+    request.traderId = fields[0];
+
+    // A cancel or replace can only name a symbol that already has orders
+    request.symbol = SymbolRegistry::instance().find(std::string(fields[1]));
+    if (request.symbol == kInvalidSymbolId) {
+        return OrderRejectReason::UNKNOWN_SYMBOL;
+    }
+    if (request.isCancel) {
+        return OrderRejectReason::NONE;
+    }
+    if (!parsePrice(fields[3], tickSizeOf(request.symbol), request.price) || request.price <= 0) {
+        return OrderRejectReason::INVALID_PRICE;
+    }
+    if (!parsePositive(fields[4], request.quantity)) {
+        return OrderRejectReason::INVALID_QUANTITY;
+    }
+    return OrderRejectReason::NONE;
+}
+
+bool hasConsistentOrderFields(const Order& order) {
+    if ((order.timeInForce == TimeInForce::GTD) != (order.expireTime != 0) ||
+        (order.expireTime != 0 && order.expireTime <= currentTimeMillis())) {
+        return false;
+    }
+    bool isStop = (order.type == OrderType::STOP || order.type == OrderType::STOP_LIMIT);
+    if (isStop != (order.stopPrice != 0) || order.stopPrice < 0) {
+        return false;
+    }
+    return order.displayQuantity >= 0 &&
+           (order.displayQuantity == 0 || order.type == OrderType::LIMIT ||
+            order.type == OrderType::STOP_LIMIT);
+}
@@ -0,0 +1,383 @@
+#include "SessionReactor.h"
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#include <cstdint>
+#include <stdexcept>
+#include <algorithm>
+
+namespace {
+// Events handled per epoll_wait and bytes read per recv
+constexpr int kMaxEvents = 64;
+constexpr size_t kReadBufferSize = 16384;
+
+// Messages gathered into one write
+constexpr int kMaxWriteMessages = 256;
+}
+
+bool SessionOutbox::send(std::string message, uint64_t conflationKey) {
+    bool schedule = false;
+    bool queued = true;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (closed_ || overflowed_) {
+            return false;
+        }
+        size_t backlog = pendingBytes_ + writingBytes_;
+        if (backlog + message.size() <= reactor_.maxOutboundBytes_.load(std::memory_order_relaxed)) {
+            pendingBytes_ += message.size();
+            pending_.push_back(std::move(message));
+            pendingKeys_.push_back(conflationKey);
+        } else {
+            switch (reactor_.slowConsumerPolicy_.load(std::memory_order_relaxed)) {
+                case SlowConsumerPolicy::DROP:
+                    ++dropped_;
+                    return false;
+                case SlowConsumerPolicy::CONFLATE:
+                    // Replace the latest queued message with the same key; with none
+                    // queued, let it through: the backlog grows by at most one per key
+                    if (conflationKey != 0) {
+                        auto it = std::find(pendingKeys_.rbegin(), pendingKeys_.rend(), conflationKey);
+                        if (it != pendingKeys_.rend()) {
+                            std::string& replaced = pending_[pendingKeys_.rend() - it - 1];
+                            pendingBytes_ = pendingBytes_ - replaced.size() + message.size();
+                            replaced = std::move(message);
+                            return true;
+                        }
+                        pendingBytes_ += message.size();
+                        pending_.push_back(std::move(message));
+                        pendingKeys_.push_back(conflationKey);
+                        break;
+                    }
+                    overflowed_ = true;
+                    break;
+                case SlowConsumerPolicy::DISCONNECT:
+                    overflowed_ = true;
+                    break;
+            }
+        }
+        if (overflowed_) {
+            // Give up on the session: the reactor closes it on its next flush
+            ++dropped_;
+            queued = false;
+        }
+        if (!flushScheduled_) {
+            schedule = true;
+            flushScheduled_ = true;
+        }
+    }
+    if (schedule) {
+        reactor_.scheduleFlush(shared_from_this());
+    }
+    return queued;
+}
+
+size_t SessionOutbox::getDroppedCount() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return dropped_;
+}
+
+void SessionOutbox::close() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    closed_ = true;
+    pending_.clear();
+    pendingKeys_.clear();
+    pendingBytes_ = 0;
+    writingBytes_ = 0;
+    writing_.clear();
+}
+
+SessionReactor::SessionReactor(DataHandler dataHandler, CloseHandler closeHandler)
+    : dataHandler_(std::move(dataHandler)), closeHandler_(std::move(closeHandler)),
+      epollFd_(epoll_create1(EPOLL_CLOEXEC)), wakeFd_(eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC)),
+      running_(false), slowConsumerPolicy_(SlowConsumerPolicy::DISCONNECT),
+      maxOutboundBytes_(kDefaultMaxOutboundBytes) {
+    if (epollFd_ < 0 || wakeFd_ < 0) {
+        throw std::runtime_error("Failed to create session reactor");
+    }
+    struct epoll_event event = {};
+    event.events = EPOLLIN;
+    event.data.ptr = nullptr; // The wake-up descriptor
+    epoll_ctl(epollFd_, EPOLL_CTL_ADD, wakeFd_, &event);
+}
+
+SessionReactor::~SessionReactor() {
+    stop();
+    close(wakeFd_);
+    close(epollFd_);
+}
+
+void SessionReactor::start() {
+    if (running_) {
+        return;
+    }
+    running_ = true;
+    thread_ = std::thread(&SessionReactor::run, this);
+}
+
+void SessionReactor::stop() {
+    if (running_.exchange(false)) {
+        uint64_t one = 1;
+        ssize_t written = write(wakeFd_, &one, sizeof(one));
+        (void)written;
+    }
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+
+    // Close whatever is left (also sessions added after the loop exited)
+    std::unordered_map<int, std::unique_ptr<Session>> sessions;
+    {
+        std::lock_guard<std::mutex> lock(sessionsMutex_);
+        sessions.swap(sessions_);
+    }
+    for (auto& entry : sessions) {
+        entry.second->outbox->close();
+        closeHandler_(*entry.second);
+        epoll_ctl(epollFd_, EPOLL_CTL_DEL, entry.first, nullptr);
+        close(entry.first);
+    }
+}
+
+bool SessionReactor::addSession(int socket) {
+    int flags = fcntl(socket, F_GETFL, 0);
+    if (flags < 0 || fcntl(socket, F_SETFL, flags | O_NONBLOCK) < 0) {
+        close(socket);
+        return false;
+    }
+
+    auto session = std::make_unique<Session>();
+    session->socket = socket;
+    session->outbox = std::make_shared<SessionOutbox>(*this, socket);
+    struct epoll_event event = {};
+    event.events = EPOLLIN | EPOLLRDHUP;
+    event.data.ptr = session.get();
+
+    std::lock_guard<std::mutex> lock(sessionsMutex_);
+    if (epoll_ctl(epollFd_, EPOLL_CTL_ADD, socket, &event) < 0) {
+        close(socket);
+        return false;
+    }
+    sessions_[socket] = std::move(session);
+    return true;
+}
+
+size_t SessionReactor::getSessionCount() const {
+    std::lock_guard<std::mutex> lock(sessionsMutex_);
+    return sessions_.size();
+}
+
+void SessionReactor::setSlowConsumerPolicy(SlowConsumerPolicy policy, size_t maxOutboundBytes) {
+    slowConsumerPolicy_.store(policy, std::memory_order_relaxed);
+    maxOutboundBytes_.store(maxOutboundBytes, std::memory_order_relaxed);
+}
+
+void SessionReactor::run() {
+    struct epoll_event events[kMaxEvents];
+    while (running_) {
+        int count = epoll_wait(epollFd_, events, kMaxEvents, -1);
+        if (count < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            break;
+        }
+        for (int i = 0; i < count; ++i) {
+            Session* session = static_cast<Session*>(events[i].data.ptr);
+            if (!session) {
+                // Woken up by stop() or by messages queued from another thread
+                uint64_t count;
+                ssize_t bytesRead = read(wakeFd_, &count, sizeof(count));
+                (void)bytesRead;
+                continue;
+            }
+            bool open = true;
+            if (events[i].events & EPOLLOUT) {
+                open = flush(*session->outbox);
+            }
+            // Read before acting on a hang-up so that data sent just before it is handled
+            if (open && (events[i].events & ~EPOLLOUT)) {
+                open = readSession(*session);
+            }
+            if (!open || (events[i].events & (EPOLLHUP | EPOLLERR))) {
+                closeSession(*session);
+            }
+        }
+        // One write per session for everything queued during this round
+        flushScheduled();
+    }
+}
+
+bool SessionReactor::readSession(Session& session) {
+    while (true) {
+        // Read straight into the session's frame buffer, behind any partial message
+        char* buffer = session.inbound.prepare(kReadBufferSize);
+        ssize_t bytesRead = recv(session.socket, buffer, kReadBufferSize, 0);
+        if (bytesRead > 0) {
+            session.inbound.commit(static_cast<size_t>(bytesRead));
+            if (!dataHandler_(session) || session.inbound.overflowed()) {
+                return false;
+            }
+            continue;
+        }
+        if (bytesRead == 0) {
+            return false; // Peer closed
+        }
+        if (errno == EINTR) {
+            continue;
+        }
+        return errno == EAGAIN || errno == EWOULDBLOCK;
+    }
+}
+
+void SessionReactor::closeSession(Session& session) {
+    int socket = session.socket;
+    session.outbox->close();
+    closeHandler_(session);
+    epoll_ctl(epollFd_, EPOLL_CTL_DEL, socket, nullptr);
+
+    // Forget the session before closing: once closed, accept() may reuse the descriptor
+    std::unique_ptr<Session> closed;
+    {
+        std::lock_guard<std::mutex> lock(sessionsMutex_);
+        auto it = sessions_.find(socket);
+        if (it != sessions_.end()) {
+            closed = std::move(it->second);
+            sessions_.erase(it);
+        }
+    }
+    close(socket);
+}
+
+void SessionReactor::scheduleFlush(std::shared_ptr<SessionOutbox> outbox) {
+    bool wake;
+    {
+        std::lock_guard<std::mutex> lock(flushMutex_);
+        wake = flushQueue_.empty();
+        flushQueue_.push_back(std::move(outbox));
+    }
+    // The reactor thread flushes at the end of its current round anyway; other
+    // threads wake it, once per batch of scheduled outboxes
+    if (wake && std::this_thread::get_id() != thread_.get_id()) {
+        uint64_t one = 1;
+        ssize_t written = write(wakeFd_, &one, sizeof(one));
+        (void)written;
+    }
+}
+
+void SessionReactor::flushScheduled() {
+    {
+        std::lock_guard<std::mutex> lock(flushMutex_);
+        flushing_.swap(flushQueue_);
+    }
+    for (const auto& outbox : flushing_) {
+        if (flush(*outbox)) {
+            continue;
+        }
+        Session* session = nullptr;
+        {
+            std::lock_guard<std::mutex> lock(sessionsMutex_);
+            auto it = sessions_.find(outbox->socket_);
+            if (it != sessions_.end()) {
+                session = it->second.get();
+            }
+        }
+        if (session) {
+            closeSession(*session);
+        }
+    }
+    flushing_.clear();
+}
+
+bool SessionReactor::flush(SessionOutbox& outbox) {
+    // Take everything queued so far; senders carry on filling pending_
+    {
+        std::lock_guard<std::mutex> lock(outbox.mutex_);
+        if (outbox.closed_) {
+            return true;
+        }
+        outbox.flushScheduled_ = false;
+        if (outbox.overflowed_) {
+            return false; // Slow consumer
+        }
+        for (auto& message : outbox.pending_) {
+            outbox.writing_.push_back(std::move(message));
+        }
+        outbox.writingBytes_ += outbox.pendingBytes_;
+        outbox.pending_.clear();
+        outbox.pendingKeys_.clear();
+        outbox.pendingBytes_ = 0;
+    }
+
+    // Gather the messages into as few writes as the socket allows. sendmsg is
+    // writev with MSG_NOSIGNAL, so a vanished peer doesn't raise SIGPIPE.
+    bool open = true;
+    size_t written = 0;
+    while (!outbox.writing_.empty()) {
+        struct iovec iov[kMaxWriteMessages];
+        int count = 0;
+        for (auto it = outbox.writing_.begin();
+             it != outbox.writing_.end() && count < kMaxWriteMessages; ++it, ++count) {
+            size_t offset = (count == 0) ? outbox.writeOffset_ : 0;
+            iov[count].iov_base = const_cast<char*>(it->data()) + offset;
+            iov[count].iov_len = it->size() - offset;
+        }
+        struct msghdr message = {};
+        message.msg_iov = iov;
+        message.msg_iovlen = static_cast<size_t>(count);
+        ssize_t sent = sendmsg(outbox.socket_, &message, MSG_NOSIGNAL);
+        if (sent < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            open = (errno == EAGAIN || errno == EWOULDBLOCK);
+            break;
+        }
+        written += static_cast<size_t>(sent);
+        size_t remaining = static_cast<size_t>(sent);
+        while (remaining > 0) {
+            size_t unwritten = outbox.writing_.front().size() - outbox.writeOffset_;
+            if (remaining < unwritten) {
+                outbox.writeOffset_ += remaining;
+                break;
+            }
+            remaining -= unwritten;
+            outbox.writing_.pop_front();
+            outbox.writeOffset_ = 0;
+        }
+    }
+    if (written > 0) {
+        std::lock_guard<std::mutex> lock(outbox.mutex_);
+        outbox.writingBytes_ -= written;
+    }
+    if (!open) {
+        return false;
+    }
+
+    // Socket full: finish when it becomes writable
+    bool blocked = !outbox.writing_.empty();
+    if (blocked != outbox.awaitingWritable_) {
+        setWritableInterest(outbox, blocked);
+    }
+    return true;
+}
+
+void SessionReactor::setWritableInterest(SessionOutbox& outbox, bool enabled) {
+    std::lock_guard<std::mutex> lock(sessionsMutex_);
+    auto it = sessions_.find(outbox.socket_);
+    if (it == sessions_.end()) {
+        return;
+    }
+    struct epoll_event event = {};
+    event.events = EPOLLIN | EPOLLRDHUP;
+    if (enabled) {
+        event.events |= EPOLLOUT;
+    }
+    event.data.ptr = it->second.get();
+    epoll_ctl(epollFd_, EPOLL_CTL_MOD, outbox.socket_, &event);
+    outbox.awaitingWritable_ = enabled;
+}
@@ -0,0 +1,49 @@
+#include "SymbolRegistry.h"
+#include <mutex>
+
+SymbolRegistry& SymbolRegistry::instance() {
+    static SymbolRegistry registry;
+    return registry;
+}
+
+SymbolRegistry::SymbolRegistry() : names_(new std::string[kMaxSymbols]), size_(0) {}
+
+SymbolId SymbolRegistry::intern(const std::string& name) {
+    if (name.empty()) {
+        return kInvalidSymbolId;
+    }
+    
+    {
+        std::shared_lock<std::shared_mutex> lock(mutex_);
+        auto it = ids_.find(name);
+        if (it != ids_.end()) {
+            return it->second;
+        }
+    }
+    
+    std::unique_lock<std::shared_mutex> lock(mutex_);
+    auto it = ids_.find(name);
+    if (it != ids_.end()) {
+        return it->second;
+    }
+    size_t size = size_.load(std::memory_order_relaxed);
+    if (size >= kMaxSymbols) {
+        return kInvalidSymbolId;
+    }
+    SymbolId id = static_cast<SymbolId>(size);
+    names_[id] = name;
+    ids_.emplace(name, id);
+    size_.store(size + 1, std::memory_order_release);
+    return id;
+}
+
+SymbolId SymbolRegistry::find(const std::string& name) const {
+    std::shared_lock<std::shared_mutex> lock(mutex_);
+    auto it = ids_.find(name);
+    return it != ids_.end() ? it->second : kInvalidSymbolId;
+}
+
+const std::string& SymbolRegistry::getName(SymbolId id) const {
+    static const std::string unknown = "UNKNOWN";
+    return id < size_.load(std::memory_order_acquire) ? names_[id] : unknown;
+}
@@ -0,0 +1,57 @@
+#include "TraderRegistry.h"
+#include <mutex>
+
+TraderRegistry& TraderRegistry::instance() {
+    static TraderRegistry registry;
+    return registry;
+}
+
+TraderRegistry::TraderRegistry()
+    : chunks_(new std::unique_ptr<std::string[]>[kMaxTraders / kTraderChunkSize]), size_(0) {}
+
+TraderKey TraderRegistry::intern(const std::string& traderId) {
+    if (traderId.empty()) {
+        return kInvalidTraderKey;
+    }
+    
+    {
+        std::shared_lock<std::shared_mutex> lock(mutex_);
+        auto it = keys_.find(traderId);
+        if (it != keys_.end()) {
+            return it->second;
+        }
+    }
+    
+    std::unique_lock<std::shared_mutex> lock(mutex_);
+    auto it = keys_.find(traderId);
+    if (it != keys_.end()) {
+        return it->second;
+    }
+    size_t size = size_.load(std::memory_order_relaxed);
+    if (size >= kMaxTraders) {
+        return kInvalidTraderKey;
+    }
+    std::unique_ptr<std::string[]>& chunk = chunks_[size / kTraderChunkSize];
+    if (!chunk) {
+        chunk.reset(new std::string[kTraderChunkSize]);
+    }
+    chunk[size % kTraderChunkSize] = traderId;
+    TraderKey key = static_cast<TraderKey>(size);
+    keys_.emplace(traderId, key);
+    size_.store(size + 1, std::memory_order_release);
+    return key;
+}
+
+TraderKey TraderRegistry::find(const std::string& traderId) const {
+    std::shared_lock<std::shared_mutex> lock(mutex_);
+    auto it = keys_.find(traderId);
+    return it != keys_.end() ? it->second : kInvalidTraderKey;
+}
+
+const std::string& TraderRegistry::getTraderId(TraderKey key) const {
+    static const std::string unknown = "UNKNOWN";
+    if (key >= size_.load(std::memory_order_acquire)) {
+        return unknown;
+    }
+    return chunks_[key / kTraderChunkSize][key % kTraderChunkSize];
+}
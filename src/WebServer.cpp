@@ -180,6 +180,11 @@ void WebServer::handleHttpRequest(int clientSocket, const std::string& request)
         std::string symbol = path.substr(15); // "/api/orderbook/".length()
         std::string json = getOrderBookJson(symbol);
         sendHttpResponse(clientSocket, 200, "application/json", json);
+    } else if (path.find("/api/depth/") == 0) {
+        // Get aggregated price levels for a symbol
+        std::string symbol = path.substr(11); // "/api/depth/".length()
+        std::string json = getDepthJson(symbol, 10);
+        sendHttpResponse(clientSocket, 200, "application/json", json);
     } else if (path == "/api/accounts") {
         // Get all accounts
         std::string json = getAllAccountsJson();
@@ -277,52 +282,55 @@ std::string WebServer::getOrderBookJson(const std::string& symbol) {
         return "{}";
     }
     
-    try {
-        auto& orderBook = marketServer_->getOrderBook(symbol);
-        
-        std::ostringstream json;
-        json << "{\"symbol\":\"" << symbol << "\","
-             << "\"bestBid\":" << orderBook.getBestBid() << ","
-             << "\"bestAsk\":" << orderBook.getBestAsk() << ","
-             << "\"buyOrders\":[";
-        
-        auto buyOrders = orderBook.getBuyOrders();
+    // Read the book as last published by its matching thread; its orders are
+    // copied on request, so they are as of the previous poll
+    auto snapshot = marketServer_->getOrderBookSnapshot(symbol, true);
+    if (!snapshot) {
+        return "{}";
+    }
+    double tickSize = snapshot->tickSize;
+    
+    std::ostringstream json;
+    json << "{\"symbol\":\"" << symbol << "\","
+         << "\"bestBid\":" << ticksToPrice(snapshot->bestBid, tickSize) << ","
+         << "\"bestAsk\":" << ticksToPrice(snapshot->bestAsk, tickSize) << ",";
+    
+    if (snapshot->phase == TradingPhase::CALL_AUCTION) {
+        const AuctionQuote& quote = snapshot->indicativeUncross;
+        json << "\"phase\":\"CALL_AUCTION\","
+             << "\"indicativePrice\":" << ticksToPrice(quote.price, tickSize) << ","
+             << "\"indicativeVolume\":" << quote.volume << ",";
+    } else {
+        json << "\"phase\":\"CONTINUOUS\",";
+    }
+    
+    static const std::vector<Order> noOrders;
+    auto appendOrders = [&](const std::vector<Order>& orders) {
         bool first = true;
-        for (const auto& order : buyOrders) {
-            if (!first) json << ",";
-            first = false;
-            json << "{\"orderId\":\"" << order.orderId << "\","
-                 << "\"traderId\":\"" << order.traderId << "\","
-                 << "\"price\":" << order.price << ","
-                 << "\"quantity\":" << order.quantity << ","
-                 << "\"filledQuantity\":" << order.filledQuantity << ","
-                 << "\"status\":\"" << (order.status == OrderStatus::PENDING ? "PENDING" :
-                                         order.status == OrderStatus::PARTIALLY_FILLED ? "PARTIALLY_FILLED" :
-                                         order.status == OrderStatus::FILLED ? "FILLED" : "UNKNOWN") << "\"}";
-        }
-        
-        json << "],\"sellOrders\":[";
-        
-        auto sellOrders = orderBook.getSellOrders();
-        first = true;
-        for (const auto& order : sellOrders) {
+        for (const Order& order : orders) {
             if (!first) json << ",";
             first = false;
-            json << "{\"orderId\":\"" << order.orderId << "\","
+            // Icebergs show only their displayed slice
+            double quantity = (order.displayQuantity > 0)
+                                  ? order.filledQuantity + order.visibleQuantity
+                                  : order.quantity;
+            json << "{\"orderId\":\"" << formatOrderId(order.orderId) << "\","
                  << "\"traderId\":\"" << order.traderId << "\","
-                 << "\"price\":" << order.price << ","
-                 << "\"quantity\":" << order.quantity << ","
+                 << "\"price\":" << ticksToPrice(order.price, tickSize) << ","
+                 << "\"quantity\":" << quantity << ","
                  << "\"filledQuantity\":" << order.filledQuantity << ","
                  << "\"status\":\"" << (order.status == OrderStatus::PENDING ? "PENDING" :
                                          order.status == OrderStatus::PARTIALLY_FILLED ? "PARTIALLY_FILLED" :
                                          order.status == OrderStatus::FILLED ? "FILLED" : "UNKNOWN") << "\"}";
         }
-        
-        json << "]}";
-        return json.str();
-    } catch (...) {
-        return "{}";
-    }
+    };
+    
+    json << "\"buyOrders\":[";
+    appendOrders(snapshot->orders ? snapshot->orders->buyOrders : noOrders);
+    json << "],\"sellOrders\":[";
+    appendOrders(snapshot->orders ? snapshot->orders->sellOrders : noOrders);
+    json << "]}";
+    return json.str();
 }
 
 std::string WebServer::getAllOrderBooksJson() {
@@ -345,6 +353,37 @@ std::string WebServer::getAllOrderBooksJson() {
     return json.str();
 }
 
+std::string WebServer::getDepthJson(const std::string& symbol, size_t nLevels) {
+    if (!marketServer_) {
+        return "{}";
+    }
+    
+    auto snapshot = marketServer_->getOrderBookSnapshot(symbol);
+    if (!snapshot) {
+        return "{}";
+    }
+    double tickSize = snapshot->tickSize;
+    
+    std::ostringstream json;
+    json << "{\"symbol\":\"" << symbol << "\",\"bids\":[";
+    
+    auto appendLevels = [&](const std::vector<LevelDepth>& levels) {
+        size_t count = std::min(nLevels, levels.size());
+        for (size_t i = 0; i < count; ++i) {
+            if (i > 0) json << ",";
+            json << "{\"price\":" << ticksToPrice(levels[i].price, tickSize) << ","
+                 << "\"quantity\":" << levels[i].quantity << ","
+                 << "\"orders\":" << levels[i].orderCount << "}";
+        }
+    };
+    
+    appendLevels(snapshot->bids);
+    json << "],\"asks\":[";
+    appendLevels(snapshot->asks);
+    json << "]}";
+    return json.str();
+}
+
 std::string WebServer::getAccountJson(const std::string& accountId) {
     if (!marketServer_) {
         return "{}";
@@ -5,6 +5,8 @@
 #include <memory>
 #include <thread>
 #include <chrono>
+#include <cstdlib>
+#include <sstream>
 
 std::unique_ptr<MarketServer> g_server;
 std::unique_ptr<WebServer> g_webServer;
@@ -36,7 +38,61 @@ int main(int argc, char* argv[]) {
     signal(SIGTERM, signalHandler);
     
     try {
-        g_server = std::make_unique<MarketServer>(port);
+        // Symbols are sharded across MATCHING_THREADS matching threads (default: one per core, up to 4)
+        size_t matchingThreads = 0;
+        if (const char* threads = std::getenv("MATCHING_THREADS")) {
+            matchingThreads = static_cast<size_t>(std::stoul(threads));
+        }
+        
+        // Client sessions are served by SESSION_THREADS epoll reactors (default: one per core, up to 2)
+        size_t sessionThreads = 0;
+        if (const char* threads = std::getenv("SESSION_THREADS")) {
+            sessionThreads = static_cast<size_t>(std::stoul(threads));
+        }
+        
+        g_server = std::make_unique<MarketServer>(port, matchingThreads, sessionThreads);
+        
+        // Clients that stop reading: SLOW_CONSUMER_POLICY=disconnect|drop|conflate once
+        // SESSION_OUTBOUND_LIMIT bytes (default 1 MiB) are queued for them
+        SlowConsumerPolicy slowConsumerPolicy = SlowConsumerPolicy::DISCONNECT;
+        if (const char* policy = std::getenv("SLOW_CONSUMER_POLICY")) {
+            std::string name(policy);
+            if (name == "drop") {
+                slowConsumerPolicy = SlowConsumerPolicy::DROP;
+            } else if (name == "conflate") {
+                slowConsumerPolicy = SlowConsumerPolicy::CONFLATE;
+            } else if (name != "disconnect") {
+                std::cerr << "Unknown SLOW_CONSUMER_POLICY " << name << ", using disconnect" << std::endl;
+            }
+        }
+        size_t maxOutboundBytes = kDefaultMaxOutboundBytes;
+        if (const char* limit = std::getenv("SESSION_OUTBOUND_LIMIT")) {
+            maxOutboundBytes = static_cast<size_t>(std::stoul(limit));
+        }
+        g_server->setSlowConsumerPolicy(slowConsumerPolicy, maxOutboundBytes);
+        
+        // Symbols listed in LADDER_SYMBOLS (comma-separated) use the dense price ladder book
+        if (const char* ladderSymbols = std::getenv("LADDER_SYMBOLS")) {
+            std::istringstream iss(ladderSymbols);
+            std::string symbol;
+            while (std::getline(iss, symbol, ',')) {
+                if (!symbol.empty()) {
+                    g_server->setBookMode(symbol, BookMode::LADDER);
+                }
+            }
+        }
+        
+        // Traders listed in OPERATOR_TRADERS (comma-separated) may drive call auctions
+        if (const char* operators = std::getenv("OPERATOR_TRADERS")) {
+            std::istringstream iss(operators);
+            std::string traderId;
+            while (std::getline(iss, traderId, ',')) {
+                if (!traderId.empty()) {
+                    g_server->addOperator(traderId);
+                }
+            }
+        }
+        
         g_webServer = std::make_unique<WebServer>(webPort, g_server.get());
         
         // Start web server in a separate thread
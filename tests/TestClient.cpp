@@ -108,6 +108,37 @@ std::string TestClient::submitOrder(const std::string& traderId, const std::stri
     return sendMessage(oss.str());
 }
 
+bool TestClient::sendRaw(const std::string& data) {
+    if (socket_ < 0) {
+        return false;
+    }
+    return send(socket_, data.c_str(), data.length(), 0) == static_cast<ssize_t>(data.length());
+}
+
+std::string TestClient::receiveRaw(int timeoutMs) {
+    if (socket_ < 0) {
+        return "";
+    }
+    
+    fd_set readfds;
+    struct timeval tv;
+    FD_ZERO(&readfds);
+    FD_SET(socket_, &readfds);
+    tv.tv_sec = timeoutMs / 1000;
+    tv.tv_usec = (timeoutMs % 1000) * 1000;
+    
+    if (select(socket_ + 1, &readfds, nullptr, nullptr, &tv) <= 0) {
+        return "";
+    }
+    
+    char buffer[4096];
+    ssize_t bytesRead = recv(socket_, buffer, sizeof(buffer), 0);
+    if (bytesRead <= 0) {
+        return "";
+    }
+    return std::string(buffer, static_cast<size_t>(bytesRead));
+}
+
 std::string TestClient::receiveMessage() {
     if (socket_ < 0) {
         return "";
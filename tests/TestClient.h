@@ -20,6 +20,9 @@ public:
     // Send a message and wait for response
     std::string sendMessage(const std::string& message);
     
+    // Send bytes as-is, without waiting for a response
+    bool sendRaw(const std::string& data);
+    
     // Register as a trader
     bool registerTrader(const std::string& traderId);
     
@@ -31,6 +34,9 @@ public:
     // Receive a message (non-blocking, returns empty if no message)
     std::string receiveMessage();
     
+    // Receive whatever bytes arrive within timeoutMs, unmodified (binary-safe)
+    std::string receiveRaw(int timeoutMs);
+    
     bool isConnected() const { return socket_ >= 0; }
     
 private:
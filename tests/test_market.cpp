@@ -1,14 +1,27 @@
 #include <gtest/gtest.h>
 #include <thread>
+#include <atomic>
 #include <chrono>
 #include <memory>
 #include <iostream>
 #include <sstream>
 #include <iomanip>
+#include <algorithm>
+#include <cstring>
+#include <limits>
 #include "MarketServer.h"
 #include "TestClient.h"
 #include "Account.h"
 #include "OrderBook.h"
+#include "MatchingEngine.h"
+#include "MpscQueue.h"
+#include "TimerWheel.h"
+#include "FrameBuffer.h"
+#include "BinaryProtocol.h"
+#include "OrderParser.h"
+#include "SessionReactor.h"
+#include <sys/socket.h>
+#include <poll.h>
 
 // Helper function to log order submission
 void logOrderSubmission(const std::string& traderId, const std::string& symbol,
@@ -38,9 +51,10 @@ void logOrderBook(const OrderBook& orderBook) {
     if (!buyOrders.empty()) {
         std::cout << "  Buy Orders:" << std::endl;
         for (const auto& order : buyOrders) {
-            std::cout << "    - " << order.orderId 
+            std::cout << "    - " << formatOrderId(order.orderId) 
                       << " | Trader: " << order.traderId
-                      << " | Price: " << std::fixed << std::setprecision(2) << order.price
+                      << " | Price: " << std::fixed << std::setprecision(2)
+                      << ticksToPrice(order.price, orderBook.getTickSize())
                       << " | Quantity: " << order.quantity
                       << " | Filled: " << order.filledQuantity
                       << " | Status: ";
@@ -58,9 +72,10 @@ void logOrderBook(const OrderBook& orderBook) {
     if (!sellOrders.empty()) {
         std::cout << "  Sell Orders:" << std::endl;
         for (const auto& order : sellOrders) {
-            std::cout << "    - " << order.orderId 
+            std::cout << "    - " << formatOrderId(order.orderId) 
                       << " | Trader: " << order.traderId
-                      << " | Price: " << std::fixed << std::setprecision(2) << order.price
+                      << " | Price: " << std::fixed << std::setprecision(2)
+                      << ticksToPrice(order.price, orderBook.getTickSize())
                       << " | Quantity: " << order.quantity
                       << " | Filled: " << order.filledQuantity
                       << " | Status: ";
@@ -592,3 +607,1645 @@ TEST_F(MarketServerTest, MultipleSymbols) {
     EXPECT_DOUBLE_EQ(account2->getPosition("GOOGL"), -3.0);
 }
 
+
+// Test 9: Removing an order from the middle of a level keeps FIFO order of the rest
+TEST(OrderBookTest, RemoveFromMiddleOfLevelKeepsFifoOrder) {
+    OrderBook orderBook("AAPL");
+
+    for (int i = 1; i <= 3; ++i) {
+        Order order;
+        order.orderId = i;
+        order.traderId = "trader" + std::to_string(i);
+        order.symbol = SymbolRegistry::instance().intern("AAPL");
+        order.side = OrderSide::BUY;
+        order.type = OrderType::LIMIT;
+        order.price = 15000; // 150.00 in ticks
+        order.quantity = 10;
+        orderBook.addOrder(order);
+    }
+
+    EXPECT_TRUE(orderBook.removeOrder(2));
+    EXPECT_FALSE(orderBook.removeOrder(2));
+    EXPECT_EQ(orderBook.getOrder(2), nullptr);
+
+    ASSERT_NE(orderBook.getOrder(3), nullptr);
+    EXPECT_EQ(orderBook.getOrder(3)->traderId, "trader3");
+
+    auto buyOrders = orderBook.getBuyOrders();
+    ASSERT_EQ(buyOrders.size(), 2u);
+    EXPECT_EQ(buyOrders[0].orderId, 1u);
+    EXPECT_EQ(buyOrders[1].orderId, 3u);
+
+    // A recycled node goes to the back of the queue
+    Order order;
+    order.orderId = 4;
+    order.side = OrderSide::BUY;
+    order.type = OrderType::LIMIT;
+    order.price = 15000;
+    order.quantity = 10;
+    orderBook.addOrder(order);
+
+    buyOrders = orderBook.getBuyOrders();
+    ASSERT_EQ(buyOrders.size(), 3u);
+    EXPECT_EQ(buyOrders[2].orderId, 4u);
+
+    EXPECT_TRUE(orderBook.removeOrder(1));
+    EXPECT_TRUE(orderBook.removeOrder(3));
+    EXPECT_TRUE(orderBook.removeOrder(4));
+    EXPECT_DOUBLE_EQ(orderBook.getBestBid(), 0.0);
+}
+
+// Test 10: Decimal prices map onto integer ticks of the symbol's tick size
+TEST(PriceTest, DecimalPricesConvertToTicks) {
+    Price ticks = 0;
+    ASSERT_TRUE(priceToTicks(150.00, 0.01, ticks));
+    EXPECT_EQ(ticks, 15000);
+
+    // Prices that differ only by floating-point noise land on the same tick
+    Price a = 0;
+    Price b = 0;
+    ASSERT_TRUE(priceToTicks(0.1 + 0.2, 0.01, a));
+    ASSERT_TRUE(priceToTicks(0.3, 0.01, b));
+    EXPECT_EQ(a, b);
+
+    ASSERT_TRUE(priceToTicks(99.75, 0.25, ticks));
+    EXPECT_EQ(ticks, 399);
+    EXPECT_DOUBLE_EQ(ticksToPrice(ticks, 0.25), 99.75);
+
+    // Off-grid prices are rejected
+    EXPECT_FALSE(priceToTicks(150.005, 0.01, ticks));
+    EXPECT_FALSE(priceToTicks(99.80, 0.25, ticks));
+}
+
+// Test 11: The dense ladder book behaves exactly like the tree book
+TEST(OrderBookTest, LadderModeMatchesTreeMode) {
+    OrderBook treeBook("AAPL", 0.01, BookMode::TREE);
+    OrderBook ladderBook("AAPL", 0.01, BookMode::LADDER);
+    EXPECT_EQ(ladderBook.getMode(), BookMode::LADDER);
+
+    // Prices spread wide enough to force the ladder to move its base and grow
+    const Price prices[] = {15000, 15010, 14990, 15500, 13000, 15000, 20000, 14995, 100};
+    OrderId nextId = 1;
+    std::vector<OrderId> live;
+    for (int round = 0; round < 3; ++round) {
+        for (Price price : prices) {
+            for (OrderSide side : {OrderSide::BUY, OrderSide::SELL}) {
+                Order order;
+                order.orderId = nextId++;
+                order.side = side;
+                order.type = OrderType::LIMIT;
+                order.price = price + round;
+                order.quantity = 1;
+                treeBook.addOrder(order);
+                ladderBook.addOrder(order);
+                live.push_back(order.orderId);
+            }
+        }
+        // Cancel every third live order
+        for (size_t i = 0; i < live.size(); i += 3) {
+            EXPECT_EQ(treeBook.removeOrder(live[i]), ladderBook.removeOrder(live[i]));
+        }
+
+        EXPECT_EQ(treeBook.getBestBidTicks(), ladderBook.getBestBidTicks());
+        EXPECT_EQ(treeBook.getBestAskTicks(), ladderBook.getBestAskTicks());
+
+        auto treeBuys = treeBook.getBuyOrders();
+        auto ladderBuys = ladderBook.getBuyOrders();
+        ASSERT_EQ(treeBuys.size(), ladderBuys.size());
+        for (size_t i = 0; i < treeBuys.size(); ++i) {
+            EXPECT_EQ(treeBuys[i].orderId, ladderBuys[i].orderId);
+        }
+
+        auto treeSells = treeBook.getSellOrders();
+        auto ladderSells = ladderBook.getSellOrders();
+        ASSERT_EQ(treeSells.size(), ladderSells.size());
+        for (size_t i = 0; i < treeSells.size(); ++i) {
+            EXPECT_EQ(treeSells[i].orderId, ladderSells[i].orderId);
+        }
+    }
+
+    for (OrderId orderId : live) {
+        EXPECT_EQ(treeBook.removeOrder(orderId), ladderBook.removeOrder(orderId));
+    }
+    EXPECT_EQ(ladderBook.getBestBidTicks(), 0);
+    EXPECT_EQ(ladderBook.getBestAskTicks(), 0);
+    EXPECT_TRUE(ladderBook.getBuyOrders().empty());
+}
+
+// Test 12: An aggressive order walks the live book best level first and stops when it no longer crosses
+TEST(MatchingEngineTest, SweepsLiveLevelsUntilNoLongerCrossing) {
+    OrderBook orderBook("AAPL");
+    MatchingEngine matchingEngine;
+
+    const Price askPrices[] = {15000, 15000, 15100, 15200};
+    for (int i = 0; i < 4; ++i) {
+        Order ask;
+        ask.orderId = 100 + i;
+        ask.traderId = "seller";
+        ask.symbol = SymbolRegistry::instance().intern("AAPL");
+        ask.side = OrderSide::SELL;
+        ask.type = OrderType::LIMIT;
+        ask.price = askPrices[i];
+        ask.quantity = 10;
+        matchingEngine.submitOrder(ask, orderBook);
+    }
+
+    Order buy;
+    buy.orderId = 200;
+    buy.traderId = "buyer";
+    buy.symbol = SymbolRegistry::instance().intern("AAPL");
+    buy.side = OrderSide::BUY;
+    buy.type = OrderType::LIMIT;
+    buy.price = 15100;
+    buy.quantity = 25;
+    auto trades = matchingEngine.submitOrder(buy, orderBook);
+
+    ASSERT_EQ(trades.size(), 3u);
+    EXPECT_EQ(trades[0].sellOrderId, 100u);
+    EXPECT_EQ(trades[1].sellOrderId, 101u);
+    EXPECT_EQ(trades[2].sellOrderId, 102u);
+    EXPECT_EQ(trades[2].price, 15100);
+    EXPECT_DOUBLE_EQ(trades[2].quantity, 5.0);
+    EXPECT_EQ(buy.status, OrderStatus::FILLED);
+
+    // The partially filled ask keeps its place at the front of its level
+    EXPECT_EQ(orderBook.getBestAskTicks(), 15100);
+    ASSERT_NE(orderBook.getOrder(102), nullptr);
+    EXPECT_DOUBLE_EQ(orderBook.getOrder(102)->filledQuantity, 5.0);
+    EXPECT_EQ(orderBook.getOrder(100), nullptr);
+    EXPECT_EQ(orderBook.getBestBidTicks(), 0);
+}
+
+// Test 13: Once warmed up, the add/cancel/fill path makes no further book allocations
+TEST(OrderBookTest, SteadyStateAddCancelFillDoesNotAllocate) {
+    for (BookMode mode : {BookMode::TREE, BookMode::LADDER}) {
+        OrderBook orderBook("AAPL", 0.01, mode);
+        MatchingEngine matchingEngine;
+
+        auto runCycle = [&](int cycle) {
+            // Rest 200 bids over 20 levels
+            for (int i = 0; i < 200; ++i) {
+                Order bid;
+                bid.orderId = cycle * 1000 + i + 1;
+                bid.side = OrderSide::BUY;
+                bid.type = OrderType::LIMIT;
+                bid.price = 15000 - (i % 20);
+                bid.quantity = 10;
+                matchingEngine.submitOrder(bid, orderBook);
+            }
+            // Cancel every other bid
+            for (int i = 0; i < 200; i += 2) {
+                orderBook.removeOrder(cycle * 1000 + i + 1);
+            }
+            // Fill the rest with one sweeping market sell
+            Order sell;
+            sell.orderId = cycle * 1000 + 999;
+            sell.side = OrderSide::SELL;
+            sell.type = OrderType::MARKET;
+            sell.quantity = 1000;
+            matchingEngine.submitOrder(sell, orderBook);
+        };
+
+        runCycle(0);
+        ASSERT_EQ(orderBook.getOrderCount(), 0u);
+        size_t warmAllocations = orderBook.getAllocationCount();
+        EXPECT_GT(warmAllocations, 0u);
+
+        for (int cycle = 1; cycle <= 5; ++cycle) {
+            runCycle(cycle);
+        }
+        EXPECT_EQ(orderBook.getOrderCount(), 0u);
+        EXPECT_EQ(orderBook.getAllocationCount(), warmAllocations);
+    }
+}
+
+// Test 14: Order IDs come from the server sequencer and client order IDs are echoed in acks
+TEST_F(MarketServerTest, SequencedOrderIdsAndClientOrderIdEcho) {
+    TestClient trader1("127.0.0.1", port_);
+    
+    ASSERT_TRUE(trader1.connect());
+    ASSERT_TRUE(trader1.registerTrader("trader1"));
+    
+    std::string response1 = trader1.sendMessage("ORDER:trader1:AAPL:BUY:LIMIT:150.00:10:CLID=42");
+    ASSERT_EQ(response1.find("ORDER_ACCEPTED:ORD_"), 0u) << "Response1: " << response1;
+    EXPECT_NE(response1.find(":CLID=42"), std::string::npos) << "Response1: " << response1;
+    
+    std::string response2 = trader1.sendMessage("ORDER:trader1:AAPL:BUY:LIMIT:149.00:10");
+    ASSERT_EQ(response2.find("ORDER_ACCEPTED:ORD_"), 0u) << "Response2: " << response2;
+    EXPECT_EQ(response2.find("CLID="), std::string::npos) << "Response2: " << response2;
+    
+    // IDs are strictly increasing
+    OrderId id1 = std::stoull(response1.substr(19, response1.find(':', 19) - 19));
+    OrderId id2 = std::stoull(response2.substr(19));
+    EXPECT_GT(id2, id1);
+    
+    // Prices off the tick grid are rejected
+    std::string response3 = trader1.sendMessage("ORDER:trader1:AAPL:BUY:LIMIT:150.005:10:CLID=43");
+    EXPECT_EQ(response3.find("ORDER_REJECTED:"), 0u) << "Response3: " << response3;
+    EXPECT_NE(response3.find(":CLID=43"), std::string::npos) << "Response3: " << response3;
+}
+
+// Test 15: Symbols are interned to dense, stable IDs
+TEST(SymbolRegistryTest, InternsDenseStableIds) {
+    SymbolRegistry& registry = SymbolRegistry::instance();
+
+    SymbolId first = registry.intern("INTERN_TEST_A");
+    SymbolId second = registry.intern("INTERN_TEST_B");
+    EXPECT_EQ(second, first + 1);
+    EXPECT_EQ(registry.intern("INTERN_TEST_A"), first);
+    EXPECT_EQ(registry.find("INTERN_TEST_B"), second);
+    EXPECT_EQ(registry.getName(first), "INTERN_TEST_A");
+
+    EXPECT_EQ(registry.find("INTERN_TEST_UNKNOWN"), kInvalidSymbolId);
+    EXPECT_EQ(registry.intern(""), kInvalidSymbolId);
+
+    // Positions are kept per symbol ID and readable by name at the edge
+    Account account("intern_test", 0.0);
+    EXPECT_DOUBLE_EQ(account.updatePosition(second, 5.0), 5.0);
+    EXPECT_DOUBLE_EQ(account.updatePosition(second, -2.0), 3.0);
+    EXPECT_DOUBLE_EQ(account.updatePosition(second, 2.0), 5.0);
+    EXPECT_DOUBLE_EQ(account.getPosition(second), 5.0);
+    EXPECT_DOUBLE_EQ(account.getPosition("INTERN_TEST_B"), 5.0);
+    EXPECT_DOUBLE_EQ(account.getPosition("INTERN_TEST_A"), 0.0);
+    EXPECT_DOUBLE_EQ(account.getPosition("INTERN_TEST_UNKNOWN"), 0.0);
+
+    // Names read back without locking while another thread keeps interning,
+    // across the trader registry's chunk boundaries
+    TraderRegistry& traders = TraderRegistry::instance();
+    TraderKey firstTrader = traders.intern("intern_trader_0");
+    std::atomic<bool> done{false};
+    std::thread writer([&]() {
+        for (size_t i = 1; i <= kTraderChunkSize + 1; ++i) {
+            traders.intern("intern_trader_" + std::to_string(i));
+        }
+        done = true;
+    });
+    while (!done) {
+        EXPECT_EQ(traders.getTraderId(firstTrader), "intern_trader_0");
+        EXPECT_EQ(registry.getName(first), "INTERN_TEST_A");
+    }
+    writer.join();
+    TraderKey lastTrader = traders.find("intern_trader_" + std::to_string(kTraderChunkSize + 1));
+    ASSERT_NE(lastTrader, kInvalidTraderKey);
+    EXPECT_EQ(traders.getTraderId(lastTrader), "intern_trader_" + std::to_string(kTraderChunkSize + 1));
+    EXPECT_EQ(traders.getTraderId(kInvalidTraderKey), "UNKNOWN");
+}
+
+// Test 16: Level totals track adds, partial fills and cancels without walking orders
+TEST(OrderBookTest, DepthTracksLevelAggregates) {
+    OrderBook orderBook("AAPL");
+    MatchingEngine matchingEngine;
+
+    const Price prices[] = {15000, 15000, 14990, 14980};
+    const double quantities[] = {10, 5, 7, 3};
+    for (int i = 0; i < 4; ++i) {
+        Order bid;
+        bid.orderId = i + 1;
+        bid.side = OrderSide::BUY;
+        bid.type = OrderType::LIMIT;
+        bid.price = prices[i];
+        bid.quantity = quantities[i];
+        matchingEngine.submitOrder(bid, orderBook);
+    }
+
+    auto depth = orderBook.getDepth(OrderSide::BUY, 2);
+    ASSERT_EQ(depth.size(), 2u);
+    EXPECT_EQ(depth[0].price, 15000);
+    EXPECT_DOUBLE_EQ(depth[0].quantity, 15.0);
+    EXPECT_EQ(depth[0].orderCount, 2u);
+    EXPECT_EQ(depth[1].price, 14990);
+    EXPECT_DOUBLE_EQ(depth[1].quantity, 7.0);
+
+    // Partial fill of the first order at 150.00
+    Order sell;
+    sell.orderId = 10;
+    sell.side = OrderSide::SELL;
+    sell.type = OrderType::LIMIT;
+    sell.price = 15000;
+    sell.quantity = 4;
+    matchingEngine.submitOrder(sell, orderBook);
+
+    depth = orderBook.getDepth(OrderSide::BUY, 10);
+    ASSERT_EQ(depth.size(), 3u);
+    EXPECT_DOUBLE_EQ(depth[0].quantity, 11.0);
+    EXPECT_EQ(depth[0].orderCount, 2u);
+
+    // Cancel the partially filled order: only its open quantity leaves the level
+    EXPECT_TRUE(orderBook.removeOrder(1));
+    depth = orderBook.getDepth(OrderSide::BUY, 10);
+    EXPECT_DOUBLE_EQ(depth[0].quantity, 5.0);
+    EXPECT_EQ(depth[0].orderCount, 1u);
+
+    // Fill the whole level: it disappears
+    sell.orderId = 11;
+    sell.quantity = 5;
+    sell.filledQuantity = 0;
+    sell.status = OrderStatus::PENDING;
+    matchingEngine.submitOrder(sell, orderBook);
+    depth = orderBook.getDepth(OrderSide::BUY, 10);
+    ASSERT_EQ(depth.size(), 2u);
+    EXPECT_EQ(depth[0].price, 14990);
+    EXPECT_TRUE(orderBook.getDepth(OrderSide::SELL, 10).empty());
+}
+
+// Test 17: Visitors walk the book in priority order and honour their limits
+TEST(OrderBookTest, VisitorsRespectPriorityAndLimits) {
+    OrderBook orderBook("AAPL");
+
+    // Two orders at the best ask, one behind them
+    const Price prices[] = {10100, 10000, 10000};
+    for (int i = 0; i < 3; ++i) {
+        Order ask;
+        ask.orderId = i + 1;
+        ask.side = OrderSide::SELL;
+        ask.type = OrderType::LIMIT;
+        ask.price = prices[i];
+        ask.quantity = 10;
+        orderBook.addOrder(ask);
+    }
+
+    std::vector<OrderId> visited;
+    orderBook.forEachOrder(OrderSide::SELL, kNoLimit, [&](const Order& order) {
+        visited.push_back(order.orderId);
+        return true;
+    });
+    EXPECT_EQ(visited, (std::vector<OrderId>{2, 3, 1}));
+
+    visited.clear();
+    orderBook.forEachOrder(OrderSide::SELL, 2, [&](const Order& order) {
+        visited.push_back(order.orderId);
+        return true;
+    });
+    EXPECT_EQ(visited, (std::vector<OrderId>{2, 3}));
+
+    // Returning false stops the walk
+    visited.clear();
+    orderBook.forEachOrder(OrderSide::SELL, kNoLimit, [&](const Order& order) {
+        visited.push_back(order.orderId);
+        return false;
+    });
+    EXPECT_EQ(visited, (std::vector<OrderId>{2}));
+
+    std::vector<Price> levels;
+    orderBook.forEachLevel(OrderSide::SELL, 1, [&](const LevelDepth& level) {
+        levels.push_back(level.price);
+        EXPECT_EQ(level.orderCount, 2u);
+        return true;
+    });
+    EXPECT_EQ(levels, (std::vector<Price>{10000}));
+
+    int buyVisits = 0;
+    orderBook.forEachOrder(OrderSide::BUY, kNoLimit, [&](const Order&) { return ++buyVisits > 0; });
+    EXPECT_EQ(buyVisits, 0);
+
+    // The copying API is built on the visitor and keeps its ordering
+    auto sellOrders = orderBook.getSellOrders();
+    ASSERT_EQ(sellOrders.size(), 3u);
+    EXPECT_EQ(sellOrders[0].orderId, 2u);
+    EXPECT_EQ(sellOrders[2].orderId, 1u);
+}
+
+// Test 18: The matching-thread intake queue delivers every order once, in per-producer order
+TEST(MpscQueueTest, ConcurrentProducersKeepPerProducerOrder) {
+    constexpr int kProducers = 4;
+    constexpr int kPerProducer = 20000;
+    MpscQueue<Order> queue(1024);
+
+    std::vector<std::thread> producers;
+    for (int p = 0; p < kProducers; ++p) {
+        producers.emplace_back([&queue, p]() {
+            for (int i = 0; i < kPerProducer; ++i) {
+                Order order;
+                order.orderId = static_cast<OrderId>(p) * kPerProducer + i;
+                order.traderId = "trader" + std::to_string(p);
+                while (!queue.tryPush(std::move(order))) {
+                    std::this_thread::yield();
+                }
+            }
+        });
+    }
+
+    std::vector<int> nextExpected(kProducers, 0);
+    int received = 0;
+    Order order;
+    while (received < kProducers * kPerProducer) {
+        if (!queue.tryPop(order)) {
+            std::this_thread::yield();
+            continue;
+        }
+        int producer = static_cast<int>(order.orderId / kPerProducer);
+        ASSERT_EQ(order.traderId, "trader" + std::to_string(producer));
+        ASSERT_EQ(static_cast<int>(order.orderId % kPerProducer), nextExpected[producer]);
+        ++nextExpected[producer];
+        ++received;
+    }
+    for (auto& producer : producers) {
+        producer.join();
+    }
+    EXPECT_FALSE(queue.tryPop(order));
+}
+
+// Test 19: A batch submitted in one call matches exactly like the same orders submitted one by one
+TEST(MatchingEngineTest, BatchSubmitMatchesSequentialSubmit) {
+    OrderBook sequentialBook("AAPL");
+    OrderBook batchBook("AAPL");
+    MatchingEngine sequentialEngine;
+    MatchingEngine batchEngine;
+
+    int callbackTrades = 0;
+    batchEngine.setTradeCallback([&](const Trade&) { ++callbackTrades; });
+
+    std::vector<Order> orders;
+    const OrderSide sides[] = {OrderSide::SELL, OrderSide::SELL, OrderSide::BUY, OrderSide::BUY, OrderSide::SELL};
+    const Price prices[] = {10000, 10100, 10100, 9900, 9900};
+    const double quantities[] = {5, 5, 8, 4, 10};
+    for (int i = 0; i < 5; ++i) {
+        Order order;
+        order.orderId = i + 1;
+        order.traderId = "trader" + std::to_string(i);
+        order.symbol = SymbolRegistry::instance().intern("AAPL");
+        order.side = sides[i];
+        order.type = OrderType::LIMIT;
+        order.price = prices[i];
+        order.quantity = quantities[i];
+        orders.push_back(order);
+    }
+
+    std::vector<Trade> expected;
+    for (Order order : orders) {
+        auto trades = sequentialEngine.submitOrder(order, sequentialBook);
+        expected.insert(expected.end(), trades.begin(), trades.end());
+    }
+
+    // Fills are appended to the caller's buffer
+    std::vector<Trade> trades(1);
+    batchEngine.submitOrders(orders.data(), orders.size(), batchBook, trades);
+    ASSERT_EQ(trades.size(), expected.size() + 1);
+    for (size_t i = 0; i < expected.size(); ++i) {
+        EXPECT_EQ(trades[i + 1].buyOrderId, expected[i].buyOrderId);
+        EXPECT_EQ(trades[i + 1].sellOrderId, expected[i].sellOrderId);
+        EXPECT_EQ(trades[i + 1].price, expected[i].price);
+        EXPECT_DOUBLE_EQ(trades[i + 1].quantity, expected[i].quantity);
+    }
+    EXPECT_EQ(callbackTrades, 0);
+
+    // The orders carry their final state and the books agree
+    EXPECT_EQ(orders[2].status, OrderStatus::FILLED);
+    EXPECT_EQ(orders[4].status, OrderStatus::PENDING);
+    EXPECT_DOUBLE_EQ(orders[4].filledQuantity, 4.0);
+    EXPECT_EQ(batchBook.getBestBidTicks(), sequentialBook.getBestBidTicks());
+    EXPECT_EQ(batchBook.getBestAskTicks(), sequentialBook.getBestAskTicks());
+    EXPECT_EQ(batchBook.getOrderCount(), sequentialBook.getOrderCount());
+}
+
+// Test 20: The engine can be specialized on a static listener that sees every trade
+struct CountingTradeListener {
+    int trades = 0;
+    double quantity = 0.0;
+    void onTrade(const Trade& trade) {
+        ++trades;
+        quantity += trade.quantity;
+    }
+};
+
+TEST(MatchingEngineTest, StaticListenerReceivesTrades) {
+    OrderBook orderBook("AAPL");
+    BasicMatchingEngine<OrderBook, CountingTradeListener> engine;
+    BasicMatchingEngine<OrderBook, NullTradeListener> silentEngine;
+
+    for (int i = 0; i < 3; ++i) {
+        Order ask;
+        ask.orderId = i + 1;
+        ask.side = OrderSide::SELL;
+        ask.type = OrderType::LIMIT;
+        ask.price = 10000 + i;
+        ask.quantity = 5;
+        silentEngine.submitOrder(ask, orderBook);
+    }
+
+    Order buy;
+    buy.orderId = 10;
+    buy.side = OrderSide::BUY;
+    buy.type = OrderType::MARKET;
+    buy.quantity = 12;
+    auto trades = engine.submitOrder(buy, orderBook);
+
+    ASSERT_EQ(trades.size(), 3u);
+    EXPECT_EQ(trades[2].price, 10002);
+    EXPECT_EQ(engine.getListener().trades, 3);
+    EXPECT_DOUBLE_EQ(engine.getListener().quantity, 12.0);
+    EXPECT_EQ(buy.status, OrderStatus::FILLED);
+    EXPECT_EQ(orderBook.getOrderCount(), 1u);
+}
+
+// Test 21: A call auction collects crossing orders and uncrosses them at one volume-maximizing price
+TEST(MatchingEngineTest, CallAuctionUncrossesAtSinglePrice) {
+    OrderBook orderBook("AAPL");
+    MatchingEngine matchingEngine;
+    orderBook.setTradingPhase(TradingPhase::CALL_AUCTION);
+
+    struct Entry { OrderSide side; Price price; double quantity; };
+    const Entry entries[] = {
+        {OrderSide::BUY, 10100, 10}, {OrderSide::BUY, 10000, 10},
+        {OrderSide::SELL, 9900, 5}, {OrderSide::SELL, 10000, 10}, {OrderSide::SELL, 10200, 10},
+    };
+    OrderId nextId = 1;
+    for (const auto& entry : entries) {
+        Order order;
+        order.orderId = nextId++;
+        order.side = entry.side;
+        order.type = OrderType::LIMIT;
+        order.price = entry.price;
+        order.quantity = entry.quantity;
+        EXPECT_TRUE(matchingEngine.submitOrder(order, orderBook).empty());
+        EXPECT_EQ(order.status, OrderStatus::PENDING);
+    }
+
+    // Market orders cannot rest during the call phase
+    Order market;
+    market.orderId = nextId++;
+    market.side = OrderSide::BUY;
+    market.type = OrderType::MARKET;
+    market.quantity = 1;
+    matchingEngine.submitOrder(market, orderBook);
+    EXPECT_EQ(market.status, OrderStatus::CANCELLED);
+
+    // The book is crossed; 100.00 executes 15 against 20 at 99.00 and 10 at 101.00
+    EXPECT_EQ(orderBook.getBestBidTicks(), 10100);
+    EXPECT_EQ(orderBook.getBestAskTicks(), 9900);
+    AuctionQuote quote = orderBook.getIndicativeUncross();
+    EXPECT_EQ(quote.price, 10000);
+    EXPECT_DOUBLE_EQ(quote.volume, 15.0);
+    EXPECT_DOUBLE_EQ(quote.surplus, 5.0);
+
+    std::vector<Trade> trades;
+    EXPECT_DOUBLE_EQ(matchingEngine.uncross(orderBook, trades), 15.0);
+    ASSERT_EQ(trades.size(), 3u);
+    for (const auto& trade : trades) {
+        EXPECT_EQ(trade.price, 10000);
+    }
+    EXPECT_EQ(trades[0].buyOrderId, 1u);
+    EXPECT_EQ(trades[0].sellOrderId, 3u);
+
+    // Uncrossed book: 5 left bid at 100.00, the 102.00 offer untouched
+    EXPECT_EQ(orderBook.getBestBidTicks(), 10000);
+    EXPECT_DOUBLE_EQ(orderBook.getDepth(OrderSide::BUY, 1)[0].quantity, 5.0);
+    EXPECT_EQ(orderBook.getBestAskTicks(), 10200);
+    EXPECT_DOUBLE_EQ(orderBook.getIndicativeUncross().volume, 0.0);
+    EXPECT_EQ(orderBook.getTradingPhase(), TradingPhase::CALL_AUCTION);
+}
+
+// Test 22: IOC remainders are cancelled and FOK orders fill completely or not at all
+TEST(MatchingEngineTest, ImmediateOrCancelAndFillOrKill) {
+    OrderBook orderBook("AAPL");
+    MatchingEngine matchingEngine;
+
+    for (int i = 0; i < 2; ++i) {
+        Order ask;
+        ask.orderId = i + 1;
+        ask.side = OrderSide::SELL;
+        ask.type = OrderType::LIMIT;
+        ask.price = 10000 + 100 * i;
+        ask.quantity = 5;
+        matchingEngine.submitOrder(ask, orderBook);
+    }
+
+    // FOK for more than is available up to its limit: killed, book untouched
+    Order fok;
+    fok.orderId = 10;
+    fok.side = OrderSide::BUY;
+    fok.type = OrderType::LIMIT;
+    fok.timeInForce = TimeInForce::FOK;
+    fok.price = 10000;
+    fok.quantity = 6;
+    EXPECT_TRUE(matchingEngine.submitOrder(fok, orderBook).empty());
+    EXPECT_EQ(fok.status, OrderStatus::CANCELLED);
+    EXPECT_DOUBLE_EQ(orderBook.getDepth(OrderSide::SELL, 1)[0].quantity, 5.0);
+    EXPECT_EQ(orderBook.getOrderCount(), 2u);
+
+    // Same FOK with a limit reaching the second level: fills completely
+    fok.orderId = 11;
+    fok.status = OrderStatus::PENDING;
+    fok.price = 10100;
+    EXPECT_EQ(matchingEngine.submitOrder(fok, orderBook).size(), 2u);
+    EXPECT_EQ(fok.status, OrderStatus::FILLED);
+
+    // IOC: takes the remaining 4, the rest is cancelled instead of resting
+    Order ioc;
+    ioc.orderId = 12;
+    ioc.side = OrderSide::BUY;
+    ioc.type = OrderType::LIMIT;
+    ioc.timeInForce = TimeInForce::IOC;
+    ioc.price = 10100;
+    ioc.quantity = 10;
+    EXPECT_EQ(matchingEngine.submitOrder(ioc, orderBook).size(), 1u);
+    EXPECT_EQ(ioc.status, OrderStatus::CANCELLED);
+    EXPECT_DOUBLE_EQ(ioc.filledQuantity, 4.0);
+    EXPECT_EQ(orderBook.getOrderCount(), 0u);
+    EXPECT_EQ(orderBook.getOrder(12), nullptr);
+}
+
+// Test 23: Icebergs display one slice at a time and refill it at the back of the level
+TEST(MatchingEngineTest, IcebergReplenishesDisplayedSlice) {
+    OrderBook orderBook("AAPL");
+    MatchingEngine matchingEngine;
+
+    Order iceberg;
+    iceberg.orderId = 1;
+    iceberg.side = OrderSide::SELL;
+    iceberg.type = OrderType::LIMIT;
+    iceberg.price = 10000;
+    iceberg.quantity = 25;
+    iceberg.displayQuantity = 10;
+    matchingEngine.submitOrder(iceberg, orderBook);
+
+    Order plain = iceberg;
+    plain.orderId = 2;
+    plain.quantity = 5;
+    plain.displayQuantity = 0;
+    matchingEngine.submitOrder(plain, orderBook);
+
+    // Only the slice is displayed
+    auto depth = orderBook.getDepth(OrderSide::SELL, 1);
+    EXPECT_DOUBLE_EQ(depth[0].quantity, 15.0);
+    EXPECT_DOUBLE_EQ(depth[0].hiddenQuantity, 15.0);
+    EXPECT_EQ(depth[0].orderCount, 2u);
+
+    // Taking the slice refills it behind the plain order
+    Order buy;
+    buy.orderId = 3;
+    buy.side = OrderSide::BUY;
+    buy.type = OrderType::LIMIT;
+    buy.price = 10000;
+    buy.quantity = 12;
+    auto trades = matchingEngine.submitOrder(buy, orderBook);
+    ASSERT_EQ(trades.size(), 2u);
+    EXPECT_EQ(trades[0].sellOrderId, 1u);
+    EXPECT_DOUBLE_EQ(trades[0].quantity, 10.0);
+    EXPECT_EQ(trades[1].sellOrderId, 2u);
+    EXPECT_DOUBLE_EQ(trades[1].quantity, 2.0);
+
+    depth = orderBook.getDepth(OrderSide::SELL, 1);
+    EXPECT_DOUBLE_EQ(depth[0].quantity, 13.0);  // 3 left of plain + new 10 slice
+    EXPECT_DOUBLE_EQ(depth[0].hiddenQuantity, 5.0);
+    EXPECT_EQ(orderBook.bestOrder(OrderSide::SELL)->orderId, 2u);
+
+    // FOK counts the reserve, so an order for everything left (3 + 10 shown, 5 hidden) fills
+    Order fok = buy;
+    fok.orderId = 4;
+    fok.filledQuantity = 0;
+    fok.status = OrderStatus::PENDING;
+    fok.timeInForce = TimeInForce::FOK;
+    fok.quantity = 18;
+    matchingEngine.submitOrder(fok, orderBook);
+    EXPECT_EQ(fok.status, OrderStatus::FILLED);
+    EXPECT_EQ(orderBook.getOrderCount(), 0u);
+    EXPECT_EQ(orderBook.getOrder(1), nullptr);
+}
+
+// Test 24: Stops wait in the trigger book and cascade in the same matching pass
+TEST(MatchingEngineTest, StopOrdersTriggerAndCascade) {
+    OrderBook orderBook("AAPL");
+    MatchingEngine matchingEngine;
+
+    auto makeOrder = [](OrderId id, OrderSide side, OrderType type, Price price, Price stopPrice, double quantity) {
+        Order order;
+        order.orderId = id;
+        order.side = side;
+        order.type = type;
+        order.price = price;
+        order.stopPrice = stopPrice;
+        order.quantity = quantity;
+        return order;
+    };
+
+    Order bid99 = makeOrder(1, OrderSide::BUY, OrderType::LIMIT, 9900, 0, 5);
+    Order bid98 = makeOrder(2, OrderSide::BUY, OrderType::LIMIT, 9800, 0, 5);
+    Order sellStop = makeOrder(3, OrderSide::SELL, OrderType::STOP, 0, 9900, 5);
+    Order sellStopLimit = makeOrder(4, OrderSide::SELL, OrderType::STOP_LIMIT, 9700, 9800, 5);
+    Order buyStop = makeOrder(5, OrderSide::BUY, OrderType::STOP, 0, 10100, 5);
+    for (Order* order : {&bid99, &bid98, &sellStop, &sellStopLimit, &buyStop}) {
+        EXPECT_TRUE(matchingEngine.submitOrder(*order, orderBook).empty());
+    }
+    EXPECT_EQ(orderBook.getStopOrderCount(), 3u);
+    EXPECT_EQ(orderBook.getOrderCount(), 2u);
+
+    // A sell at 99.00 triggers the 99.00 stop, whose fill at 98.00 triggers the 98.00 stop-limit
+    Order sell = makeOrder(6, OrderSide::SELL, OrderType::MARKET, 0, 0, 5);
+    auto trades = matchingEngine.submitOrder(sell, orderBook);
+    ASSERT_EQ(trades.size(), 2u);
+    EXPECT_EQ(trades[0].price, 9900);
+    EXPECT_EQ(trades[1].sellOrderId, 3u);
+    EXPECT_EQ(trades[1].price, 9800);
+    EXPECT_EQ(orderBook.getLastTradePrice(), 9800);
+
+    // The stop-limit found no bids at 97.00 or better and rests as a limit order
+    EXPECT_EQ(orderBook.getStopOrderCount(), 1u);
+    ASSERT_NE(orderBook.getOrder(4), nullptr);
+    EXPECT_EQ(orderBook.getOrder(4)->type, OrderType::LIMIT);
+    EXPECT_EQ(orderBook.getBestAskTicks(), 9700);
+    EXPECT_EQ(orderBook.getBestBidTicks(), 0);
+
+    // A buy that sweeps 100.00 and 101.00 prints through a sell stop at 100.00
+    // even though its last print is above it
+    OrderBook sweptBook("MSFT");
+    Order ask100 = makeOrder(7, OrderSide::SELL, OrderType::LIMIT, 10000, 0, 5);
+    Order ask101 = makeOrder(8, OrderSide::SELL, OrderType::LIMIT, 10100, 0, 5);
+    Order bid = makeOrder(9, OrderSide::BUY, OrderType::LIMIT, 9900, 0, 5);
+    Order sweptStop = makeOrder(10, OrderSide::SELL, OrderType::STOP, 0, 10000, 5);
+    for (Order* order : {&ask100, &ask101, &bid, &sweptStop}) {
+        EXPECT_TRUE(matchingEngine.submitOrder(*order, sweptBook).empty());
+    }
+    Order sweep = makeOrder(11, OrderSide::BUY, OrderType::MARKET, 0, 0, 10);
+    trades = matchingEngine.submitOrder(sweep, sweptBook);
+    ASSERT_EQ(trades.size(), 3u);
+    EXPECT_EQ(trades[1].price, 10100);
+    EXPECT_EQ(trades[2].sellOrderId, 10u);
+    EXPECT_EQ(trades[2].price, 9900);
+    EXPECT_EQ(sweptBook.getStopOrderCount(), 0u);
+}
+
+// Test 25: Cancel/replace amends in place and keeps priority on size-down
+TEST(MatchingEngineTest, CancelReplaceKeepsPriorityOnSizeDown) {
+    OrderBook orderBook("AAPL");
+    MatchingEngine matchingEngine;
+    std::vector<Trade> trades;
+
+    auto makeOrder = [](OrderId id, OrderSide side, Price price, double quantity) {
+        Order order;
+        order.orderId = id;
+        order.side = side;
+        order.type = OrderType::LIMIT;
+        order.price = price;
+        order.quantity = quantity;
+        return order;
+    };
+
+    Order ask1 = makeOrder(1, OrderSide::SELL, 10100, 10);
+    Order ask2 = makeOrder(2, OrderSide::SELL, 10100, 10);
+    Order bid = makeOrder(3, OrderSide::BUY, 9900, 10);
+    matchingEngine.submitOrder(ask1, orderBook);
+    matchingEngine.submitOrder(ask2, orderBook);
+    matchingEngine.submitOrder(bid, orderBook);
+
+    // Size-down keeps order 1 at the front
+    EXPECT_TRUE(matchingEngine.replaceOrder(1, 10100, 4, orderBook, trades));
+    EXPECT_TRUE(trades.empty());
+    EXPECT_EQ(orderBook.bestOrder(OrderSide::SELL)->orderId, 1u);
+    EXPECT_DOUBLE_EQ(orderBook.getDepth(OrderSide::SELL, 1)[0].quantity, 14.0);
+
+    // Size-up loses priority
+    EXPECT_TRUE(matchingEngine.replaceOrder(1, 10100, 6, orderBook, trades));
+    EXPECT_EQ(orderBook.bestOrder(OrderSide::SELL)->orderId, 2u);
+
+    // Re-price without crossing moves order 2 to its own level
+    EXPECT_TRUE(matchingEngine.replaceOrder(2, 10000, 10, orderBook, trades));
+    EXPECT_TRUE(trades.empty());
+    EXPECT_EQ(orderBook.getBestAskTicks(), 10000);
+    EXPECT_EQ(orderBook.getDepth(OrderSide::SELL, 2).size(), 2u);
+    EXPECT_EQ(orderBook.getOrderCount(), 3u);
+
+    // Re-pricing the bid through the ask matches it
+    EXPECT_TRUE(matchingEngine.replaceOrder(3, 10000, 4, orderBook, trades));
+    ASSERT_EQ(trades.size(), 1u);
+    EXPECT_EQ(trades[0].buyOrderId, 3u);
+    EXPECT_EQ(trades[0].sellOrderId, 2u);
+    EXPECT_EQ(trades[0].price, 10000);
+    EXPECT_EQ(orderBook.getOrder(3), nullptr);
+
+    // A replace below what has filled is refused; cancels find resting orders and stops
+    EXPECT_FALSE(matchingEngine.replaceOrder(2, 10000, 4, orderBook, trades));
+    EXPECT_FALSE(matchingEngine.replaceOrder(99, 10000, 4, orderBook, trades));
+    Order stop = makeOrder(4, OrderSide::BUY, 0, 5);
+    stop.type = OrderType::STOP;
+    stop.stopPrice = 10500;
+    matchingEngine.submitOrder(stop, orderBook);
+    ASSERT_NE(orderBook.getOrder(4), nullptr);
+    EXPECT_TRUE(orderBook.removeOrder(4));
+    EXPECT_EQ(orderBook.getStopOrderCount(), 0u);
+    EXPECT_TRUE(orderBook.removeOrder(2));
+    EXPECT_FALSE(orderBook.removeOrder(2));
+    EXPECT_EQ(orderBook.getBestAskTicks(), 10100);
+}
+
+// Test 26: The timer wheel fires each deadline once and GTD orders expire from the book
+TEST(OrderBookTest, TimerWheelExpiresGoodTillDateOrders) {
+    // Deadlines spread across several wheel levels fire exactly when due
+    TimerWheel wheel(1000);
+    std::vector<uint64_t> deadlines = {1000, 1001, 1063, 1064, 1200, 5096, 300000, 1000 + (1ull << 31)};
+    for (size_t i = 0; i < deadlines.size(); ++i) {
+        wheel.schedule(i, deadlines[i]);
+    }
+    wheel.schedule(99, 500); // Already due
+    std::vector<uint64_t> fired;
+    uint64_t now = 999;
+    while (!wheel.empty() && now < 400000) {
+        now += 7;
+        wheel.advance(now, [&](uint64_t id, uint64_t deadline) {
+            EXPECT_LE(deadline, now);
+            if (id != 99) {
+                EXPECT_GT(deadline + 7, now);
+            }
+            fired.push_back(id);
+        });
+    }
+    ASSERT_EQ(fired.size(), deadlines.size()); // Everything but the far deadline, plus 99
+    EXPECT_NE(std::find(fired.begin(), fired.end(), 99u), fired.end());
+    EXPECT_EQ(wheel.size(), 1u);
+    EXPECT_EQ(wheel.advance(1000 + (1ull << 31), [](uint64_t, uint64_t) {}), 1u);
+
+    // GTD orders and stops leave the book when due; filled ones are skipped
+    OrderBook orderBook("AAPL");
+    MatchingEngine matchingEngine;
+    uint64_t start = currentTimeMillis();
+    auto makeOrder = [&](OrderId id, OrderSide side, Price price, uint64_t expireTime) {
+        Order order;
+        order.orderId = id;
+        order.traderId = "T" + std::to_string(id);
+        order.side = side;
+        order.type = OrderType::LIMIT;
+        order.price = price;
+        order.quantity = 10;
+        order.timeInForce = TimeInForce::GTD;
+        order.expireTime = expireTime;
+        return order;
+    };
+    Order soon = makeOrder(1, OrderSide::BUY, 9900, start + 50);
+    Order later = makeOrder(2, OrderSide::BUY, 9800, start + 5000);
+    Order filled = makeOrder(3, OrderSide::SELL, 10100, start + 50);
+    Order stop = makeOrder(4, OrderSide::SELL, 0, start + 50);
+    stop.type = OrderType::STOP;
+    stop.stopPrice = 9000;
+    for (Order* order : {&soon, &later, &filled, &stop}) {
+        matchingEngine.submitOrder(*order, orderBook);
+    }
+    Order taker = makeOrder(5, OrderSide::BUY, 10100, 0);
+    taker.timeInForce = TimeInForce::IOC;
+    matchingEngine.submitOrder(taker, orderBook);
+    EXPECT_EQ(taker.status, OrderStatus::FILLED);
+
+    std::vector<Order> expired;
+    EXPECT_EQ(orderBook.expireOrders(start + 10, expired), 0u);
+    EXPECT_EQ(orderBook.expireOrders(start + 100, expired), 2u);
+    ASSERT_EQ(expired.size(), 2u);
+    EXPECT_EQ(orderBook.getOrder(1), nullptr);
+    EXPECT_EQ(orderBook.getStopOrderCount(), 0u);
+    EXPECT_EQ(orderBook.getBestBidTicks(), 9800);
+    EXPECT_EQ(orderBook.getPendingExpiryCount(), 1u);
+    EXPECT_EQ(orderBook.expireOrders(start + 5000, expired), 1u);
+    EXPECT_EQ(orderBook.getOrderCount(), 0u);
+}
+
+// Test 27: Self-trade prevention never crosses a trader against themselves
+TEST(MatchingEngineTest, SelfTradePreventionModes) {
+    TraderKey alice = TraderRegistry::instance().intern("STP_ALICE");
+    TraderKey bob = TraderRegistry::instance().intern("STP_BOB");
+    EXPECT_NE(alice, bob);
+    EXPECT_EQ(TraderRegistry::instance().intern("STP_ALICE"), alice);
+    EXPECT_EQ(TraderRegistry::instance().getTraderId(bob), "STP_BOB");
+
+    auto makeOrder = [](OrderId id, TraderKey trader, OrderSide side, Price price, double quantity) {
+        Order order;
+        order.orderId = id;
+        order.traderKey = trader;
+        order.side = side;
+        order.type = OrderType::LIMIT;
+        order.price = price;
+        order.quantity = quantity;
+        return order;
+    };
+    // Book: alice 5 @ 100.00 ahead of bob 5 @ 100.00
+    auto seed = [&](OrderBook& orderBook, MatchingEngine& matchingEngine) {
+        Order own = makeOrder(1, alice, OrderSide::SELL, 10000, 5);
+        Order other = makeOrder(2, bob, OrderSide::SELL, 10000, 5);
+        matchingEngine.submitOrder(own, orderBook);
+        matchingEngine.submitOrder(other, orderBook);
+    };
+
+    // Cancel newest: alice's buy stops at her own ask and does not rest
+    {
+        OrderBook orderBook("AAPL");
+        MatchingEngine matchingEngine;
+        seed(orderBook, matchingEngine);
+        Order buy = makeOrder(3, alice, OrderSide::BUY, 10000, 8);
+        buy.selfTradePrevention = SelfTradePrevention::CANCEL_NEWEST;
+        EXPECT_TRUE(matchingEngine.submitOrder(buy, orderBook).empty());
+        EXPECT_EQ(buy.status, OrderStatus::CANCELLED);
+        EXPECT_EQ(orderBook.getOrderCount(), 2u);
+        EXPECT_TRUE(matchingEngine.getEngineCancels().empty());
+    }
+
+    // Cancel oldest: alice's ask is removed and the buy trades with bob
+    {
+        OrderBook orderBook("AAPL");
+        MatchingEngine matchingEngine;
+        seed(orderBook, matchingEngine);
+        Order buy = makeOrder(3, alice, OrderSide::BUY, 10000, 8);
+        buy.selfTradePrevention = SelfTradePrevention::CANCEL_OLDEST;
+        auto trades = matchingEngine.submitOrder(buy, orderBook);
+        ASSERT_EQ(trades.size(), 1u);
+        EXPECT_EQ(trades[0].sellOrderId, 2u);
+        ASSERT_EQ(matchingEngine.getEngineCancels().size(), 1u);
+        EXPECT_EQ(matchingEngine.getEngineCancels()[0].orderId, 1u);
+        EXPECT_DOUBLE_EQ(buy.filledQuantity, 5.0);
+        EXPECT_EQ(orderBook.getBestBidTicks(), 10000); // 3 left resting
+        EXPECT_EQ(orderBook.getBestAskTicks(), 0);
+    }
+
+    // Decrement both: 3 comes off alice's ask and the buy without a trade
+    {
+        OrderBook orderBook("AAPL");
+        MatchingEngine matchingEngine;
+        seed(orderBook, matchingEngine);
+        Order buy = makeOrder(3, alice, OrderSide::BUY, 10000, 3);
+        buy.selfTradePrevention = SelfTradePrevention::DECREMENT_BOTH;
+        EXPECT_TRUE(matchingEngine.submitOrder(buy, orderBook).empty());
+        EXPECT_EQ(buy.status, OrderStatus::CANCELLED);
+        ASSERT_NE(orderBook.getOrder(1), nullptr);
+        EXPECT_DOUBLE_EQ(orderBook.getOrder(1)->quantity, 2.0);
+        EXPECT_EQ(orderBook.bestOrder(OrderSide::SELL)->orderId, 1u);
+        EXPECT_DOUBLE_EQ(orderBook.getDepth(OrderSide::SELL, 1)[0].quantity, 7.0);
+        // The shrunk ask is reported to alice
+        ASSERT_EQ(matchingEngine.getEngineAmends().size(), 1u);
+        EXPECT_EQ(matchingEngine.getEngineAmends()[0].orderId, 1u);
+        EXPECT_DOUBLE_EQ(matchingEngine.getEngineAmends()[0].quantity, 2.0);
+    }
+
+    // FOK: alice's own ask is not liquidity for her, so with bob's 5 ahead of
+    // it a FOK for 10 is killed untouched rather than filling 5 and cancelling
+    for (SelfTradePrevention mode : {SelfTradePrevention::CANCEL_NEWEST,
+                                     SelfTradePrevention::CANCEL_OLDEST}) {
+        OrderBook orderBook("AAPL");
+        MatchingEngine matchingEngine;
+        Order other = makeOrder(1, bob, OrderSide::SELL, 10000, 5);
+        Order own = makeOrder(2, alice, OrderSide::SELL, 10000, 5);
+        matchingEngine.submitOrder(other, orderBook);
+        matchingEngine.submitOrder(own, orderBook);
+        Order buy = makeOrder(3, alice, OrderSide::BUY, 10000, 10);
+        buy.timeInForce = TimeInForce::FOK;
+        buy.selfTradePrevention = mode;
+        EXPECT_TRUE(matchingEngine.submitOrder(buy, orderBook).empty());
+        EXPECT_EQ(buy.status, OrderStatus::CANCELLED);
+        EXPECT_DOUBLE_EQ(buy.filledQuantity, 0.0);
+        EXPECT_EQ(orderBook.getOrderCount(), 2u);
+    }
+
+    // A replace that crosses into alice's own ask is killed like a new order,
+    // and the replace hands back its final state so the owner can be told
+    {
+        OrderBook orderBook("AAPL");
+        MatchingEngine matchingEngine;
+        seed(orderBook, matchingEngine);
+        Order bid = makeOrder(3, alice, OrderSide::BUY, 9900, 5);
+        bid.selfTradePrevention = SelfTradePrevention::CANCEL_NEWEST;
+        matchingEngine.submitOrder(bid, orderBook);
+        std::vector<Trade> trades;
+        Order replaced;
+        EXPECT_TRUE(matchingEngine.replaceOrder(3, 10000, 5, orderBook, trades, &replaced));
+        EXPECT_TRUE(trades.empty());
+        EXPECT_EQ(replaced.orderId, 3u);
+        EXPECT_EQ(replaced.status, OrderStatus::CANCELLED);
+        EXPECT_TRUE(matchingEngine.getEngineCancels().empty());
+        EXPECT_EQ(orderBook.getOrder(3), nullptr);
+        EXPECT_EQ(orderBook.getOrderCount(), 2u);
+    }
+}
+
+// Test 28: Trades are flat integer records; IDs follow the shard's strided sequence
+TEST(MatchingEngineTest, TradesCarryIntegerIds) {
+    OrderBook orderBook("AAPL");
+    MatchingEngine matchingEngine(3, 4); // Shard 3 of 4
+    TraderKey seller = TraderRegistry::instance().intern("TRADE_ID_SELLER");
+    TraderKey buyer = TraderRegistry::instance().intern("TRADE_ID_BUYER");
+
+    for (OrderId id = 1; id <= 2; ++id) {
+        Order sell;
+        sell.orderId = id;
+        sell.traderKey = seller;
+        sell.side = OrderSide::SELL;
+        sell.type = OrderType::LIMIT;
+        sell.price = 10000;
+        sell.quantity = 5;
+        matchingEngine.submitOrder(sell, orderBook);
+    }
+    Order buy;
+    buy.orderId = 3;
+    buy.traderKey = buyer;
+    buy.side = OrderSide::BUY;
+    buy.type = OrderType::MARKET;
+    buy.quantity = 10;
+    auto trades = matchingEngine.submitOrder(buy, orderBook);
+
+    ASSERT_EQ(trades.size(), 2u);
+    EXPECT_EQ(trades[0].tradeId, 3u);
+    EXPECT_EQ(trades[1].tradeId, 7u);
+    EXPECT_EQ(trades[0].buyTraderKey, buyer);
+    EXPECT_EQ(trades[0].sellTraderKey, seller);
+    EXPECT_EQ(TraderRegistry::instance().getTraderId(trades[1].sellTraderKey), "TRADE_ID_SELLER");
+    EXPECT_EQ(formatTradeId(trades[1].tradeId), "TRADE_00000007");
+    EXPECT_EQ(formatTradeId(123456789012ull), "TRADE_123456789012");
+}
+
+// Test 29: A fixed pool of reactor threads serves many concurrent sessions
+TEST_F(MarketServerTest, ReactorsServeManyConnections) {
+    EXPECT_GE(server_->getSessionThreadCount(), 1u);
+    EXPECT_LE(server_->getSessionThreadCount(), 2u);
+
+    constexpr int kClients = 50;
+    std::vector<std::unique_ptr<TestClient>> clients;
+    for (int i = 0; i < kClients; ++i) {
+        clients.push_back(std::make_unique<TestClient>("127.0.0.1", port_));
+        ASSERT_TRUE(clients.back()->connect()) << "Failed to connect client " << i;
+    }
+    for (int i = 0; i < kClients; ++i) {
+        ASSERT_TRUE(clients[i]->registerTrader("reactor_trader" + std::to_string(i)));
+    }
+
+    // Every session gets its own acknowledgement
+    for (int i = 0; i < kClients; ++i) {
+        std::string response = clients[i]->submitOrder("reactor_trader" + std::to_string(i), "RCTR",
+                                                       i % 2 == 0 ? "BUY" : "SELL", "LIMIT",
+                                                       i % 2 == 0 ? 10.00 : 11.00, 1);
+        EXPECT_EQ(response.find("ORDER_ACCEPTED:"), 0u) << "Client " << i << ": " << response;
+    }
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    EXPECT_EQ(server_->getOrderBook("RCTR").getOrderCount(), static_cast<size_t>(kClients));
+}
+
+// Test 30: Frames are reassembled across reads and pipelined messages are all processed
+TEST_F(MarketServerTest, PipelinedMessagesAreFramedAcrossReads) {
+    // Buffer level: frames split across reads, several per read, CRLF endings
+    FrameBuffer frames(16);
+    std::string_view line;
+    auto feed = [&](const std::string& bytes) {
+        std::memcpy(frames.prepare(bytes.size()), bytes.data(), bytes.size());
+        frames.commit(bytes.size());
+    };
+    feed("ORD");
+    EXPECT_FALSE(frames.nextLine(line));
+    feed("ER:1\r\nORDER:2\nORD");
+    ASSERT_TRUE(frames.nextLine(line));
+    EXPECT_EQ(line, "ORDER:1");
+    ASSERT_TRUE(frames.nextLine(line));
+    EXPECT_EQ(line, "ORDER:2");
+    EXPECT_FALSE(frames.nextLine(line));
+    feed("ER:3\n");
+    ASSERT_TRUE(frames.nextLine(line));
+    EXPECT_EQ(line, "ORDER:3");
+    feed("A partial frame longer than the limit");
+    EXPECT_FALSE(frames.nextLine(line));
+    EXPECT_TRUE(frames.overflowed());
+
+    // Session level: three orders pipelined in two segments, one split mid-line
+    TestClient trader("127.0.0.1", port_);
+    ASSERT_TRUE(trader.connect());
+    ASSERT_TRUE(trader.registerTrader("pipeline_trader"));
+    ASSERT_TRUE(trader.sendRaw("ORDER:pipeline_trader:PIPE:BUY:LIMIT:10.00:1\n"
+                               "ORDER:pipeline_trader:PIPE:BUY:LIMIT:10.01:1\n"
+                               "ORDER:pipeline_trader:PI"));
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    ASSERT_TRUE(trader.sendRaw("PE:BUY:LIMIT:10.02:1\n"));
+
+    auto countAccepted = [](const std::string& text) {
+        size_t count = 0;
+        for (size_t pos = text.find("ORDER_ACCEPTED:"); pos != std::string::npos;
+             pos = text.find("ORDER_ACCEPTED:", pos + 1)) {
+            ++count;
+        }
+        return count;
+    };
+    std::string acks;
+    for (int i = 0; i < 20 && countAccepted(acks) < 3; ++i) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(25));
+        acks += trader.receiveMessage() + "\n";
+    }
+    size_t accepted = countAccepted(acks);
+    EXPECT_EQ(accepted, 3u) << acks;
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    const OrderBook& orderBook = server_->getOrderBook("PIPE");
+    EXPECT_EQ(orderBook.getOrderCount(), 3u);
+    EXPECT_EQ(orderBook.getBestBidTicks(), 1002);
+}
+
+// Test 31: A session registered as BINARY trades through fixed-layout messages alongside text sessions
+TEST_F(MarketServerTest, BinarySessionTradesWithTextSession) {
+    TestClient seller("127.0.0.1", port_);
+    ASSERT_TRUE(seller.connect());
+    ASSERT_TRUE(seller.registerTrader("text_seller"));
+    EXPECT_NE(seller.submitOrder("text_seller", "BIN", "SELL", "LIMIT", 10.00, 5).find("ORDER_ACCEPTED:"),
+              std::string::npos);
+
+    TestClient buyer("127.0.0.1", port_);
+    ASSERT_TRUE(buyer.connect());
+    EXPECT_EQ(buyer.sendMessage("REGISTER:binary_buyer:BINARY"), "REGISTERED:binary_buyer:BINARY");
+
+    // A crossing buy, an order with no quantity and a cancel of an unknown order, in one write
+    BinaryNewOrder buy = makeBinaryMessage<BinaryNewOrder>();
+    buy.side = static_cast<uint8_t>(OrderSide::BUY);
+    buy.orderType = static_cast<uint8_t>(OrderType::LIMIT);
+    setBinarySymbol(buy.symbol, "BIN");
+    buy.clientOrderId = 7;
+    buy.price = 1000;
+    buy.quantity = 5;
+    BinaryNewOrder empty = buy;
+    empty.clientOrderId = 8;
+    empty.quantity = 0;
+    BinaryCancel cancel = makeBinaryMessage<BinaryCancel>();
+    setBinarySymbol(cancel.symbol, "BIN");
+    cancel.orderId = 42;
+    std::string bytes;
+    appendBinaryMessage(bytes, buy);
+    appendBinaryMessage(bytes, empty);
+    appendBinaryMessage(bytes, cancel);
+    ASSERT_TRUE(buyer.sendRaw(bytes));
+
+    // Expect, in order: ACK(7), REJECT(8), then FILL and the cancel's REJECT from the matching thread
+    FrameBuffer inbound;
+    std::vector<std::string> frames;
+    std::string_view frame;
+    for (int i = 0; i < 40 && frames.size() < 4; ++i) {
+        std::string received = buyer.receiveRaw(25);
+        std::memcpy(inbound.prepare(received.size()), received.data(), received.size());
+        inbound.commit(received.size());
+        while (inbound.nextFrame(frame)) {
+            frames.emplace_back(frame);
+        }
+    }
+    ASSERT_EQ(frames.size(), 4u);
+
+    BinaryAck ack;
+    ASSERT_TRUE(decodeBinaryMessage(frames[0], ack));
+    EXPECT_EQ(ack.clientOrderId, 7u);
+    BinaryReject reject;
+    ASSERT_TRUE(decodeBinaryMessage(frames[1], reject));
+    EXPECT_EQ(reject.reason, BinaryRejectReason::INVALID_QUANTITY);
+    EXPECT_EQ(reject.clientOrderId, 8u);
+
+    BinaryFill fill;
+    BinaryReject cancelReject;
+    bool fillFirst = decodeBinaryMessage(frames[2], fill);
+    ASSERT_TRUE(fillFirst || decodeBinaryMessage(frames[3], fill));
+    ASSERT_TRUE(decodeBinaryMessage(frames[fillFirst ? 3 : 2], cancelReject));
+    EXPECT_EQ(fill.orderId, ack.orderId);
+    EXPECT_EQ(fill.side, static_cast<uint8_t>(OrderSide::BUY));
+    EXPECT_EQ(binarySymbol(fill.symbol), "BIN");
+    EXPECT_EQ(fill.price, 1000);
+    EXPECT_DOUBLE_EQ(fill.quantity, 5.0);
+    EXPECT_EQ(cancelReject.reason, BinaryRejectReason::UNKNOWN_ORDER);
+    EXPECT_EQ(cancelReject.orderId, 42u);
+
+    // The text side of the trade is still told in text
+    std::string sellerMessages;
+    for (int i = 0; i < 20 && sellerMessages.find("TRADE_EXECUTED:") == std::string::npos; ++i) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(25));
+        sellerMessages += seller.receiveMessage();
+    }
+    EXPECT_NE(sellerMessages.find(":BIN:SELL:5@10"), std::string::npos) << sellerMessages;
+}
+
+// Test 32: The text order parser fills every field in one pass and names the first problem it finds
+TEST(OrderParserTest, ParsesFieldsAndReportsRejectReasons) {
+    const TickSizeLookup tickSizeOf = [](SymbolId) { return 0.05; };
+    auto parse = [&](const std::string& message, Order& order) {
+        order = Order();
+        return parseOrderMessage(message, order, tickSizeOf);
+    };
+
+    Order order;
+    uint64_t expireTime = currentTimeMillis() + 60000;
+    ASSERT_EQ(parse("ORDER:parser_trader:PARSE:SELL:STOP_LIMIT:10.05:7.5:CLID=99:TIF=GTD:EXPIRE=" +
+                    std::to_string(expireTime) + ":STP=CANCEL_OLDEST:DISPLAY=2.5:STOP=10.10:", order),
+              OrderRejectReason::NONE);
+    EXPECT_EQ(order.status, OrderStatus::PENDING);
+    EXPECT_EQ(order.traderId, "parser_trader");
+    EXPECT_EQ(order.traderKey, TraderRegistry::instance().find("parser_trader"));
+    EXPECT_EQ(order.symbol, SymbolRegistry::instance().find("PARSE"));
+    EXPECT_EQ(order.side, OrderSide::SELL);
+    EXPECT_EQ(order.type, OrderType::STOP_LIMIT);
+    EXPECT_EQ(order.price, 201);      // 10.05 in 0.05 ticks
+    EXPECT_EQ(order.stopPrice, 202);
+    EXPECT_DOUBLE_EQ(order.quantity, 7.5);
+    EXPECT_EQ(order.clientOrderId, 99u);
+    EXPECT_EQ(order.timeInForce, TimeInForce::GTD);
+    EXPECT_EQ(order.expireTime, expireTime);
+    EXPECT_EQ(order.selfTradePrevention, SelfTradePrevention::CANCEL_OLDEST);
+    EXPECT_DOUBLE_EQ(order.displayQuantity, 2.5);
+
+    EXPECT_EQ(parse("ORDER:parser_trader:PARSE:BUY:LIMIT:10.00", order), OrderRejectReason::MALFORMED);
+    EXPECT_EQ(parse("ORDER:parser_trader::BUY:LIMIT:10.00:1", order), OrderRejectReason::MALFORMED);
+    EXPECT_EQ(parse("ORDER:parser_trader:PARSE:HOLD:LIMIT:10.00:1", order), OrderRejectReason::INVALID_SIDE);
+    EXPECT_EQ(parse("ORDER:parser_trader:PARSE:BUY:LIMITED:10.00:1", order), OrderRejectReason::INVALID_TYPE);
+    EXPECT_EQ(parse("ORDER:parser_trader:PARSE:BUY:LIMIT:10.01:1", order), OrderRejectReason::INVALID_PRICE);
+    EXPECT_EQ(parse("ORDER:parser_trader:PARSE:BUY:LIMIT:1O.00:1", order), OrderRejectReason::INVALID_PRICE);
+    EXPECT_EQ(parse("ORDER:parser_trader:PARSE:BUY:LIMIT:0:1", order), OrderRejectReason::INVALID_PRICE);
+    EXPECT_EQ(parse("ORDER:parser_trader:PARSE:BUY:STOP_LIMIT:0:1:STOP=10.00", order),
+              OrderRejectReason::INVALID_PRICE);
+    EXPECT_EQ(parse("ORDER:parser_trader:PARSE:BUY:MARKET:0:1", order), OrderRejectReason::NONE);
+    EXPECT_EQ(parse("ORDER:parser_trader:PARSE:BUY:LIMIT:10.00:0", order), OrderRejectReason::INVALID_QUANTITY);
+    EXPECT_EQ(parse("ORDER:parser_trader:PARSE:BUY:LIMIT:10.00:1:TIF=DAY", order), OrderRejectReason::INVALID_FIELD);
+    EXPECT_EQ(parse("ORDER:parser_trader:PARSE:BUY:LIMIT:10.00:1:COLOR=RED", order), OrderRejectReason::INVALID_FIELD);
+    EXPECT_EQ(parse("ORDER:parser_trader:PARSE:BUY:LIMIT:10.00:1:TIF=GTD", order),
+              OrderRejectReason::INCONSISTENT_FIELDS);
+    EXPECT_EQ(parse("ORDER:parser_trader:PARSE:BUY:MARKET:0:1:DISPLAY=1", order),
+              OrderRejectReason::INCONSISTENT_FIELDS);
+
+    // The first problem wins, and a later CLID is still picked up for the rejection
+    EXPECT_EQ(parse("ORDER:parser_trader:PARSE:BUY:LIMIT:10.01:0:CLID=7", order), OrderRejectReason::INVALID_PRICE);
+    EXPECT_EQ(order.status, OrderStatus::REJECTED);
+    EXPECT_EQ(order.rejectReason, OrderRejectReason::INVALID_PRICE);
+    EXPECT_EQ(order.clientOrderId, 7u);
+
+    // Cancels and replaces go through the same field rules
+    CancelReplaceRequest request;
+    std::string message; // request.traderId is a view into it
+    auto parseRequest = [&](const std::string& text) {
+        message = text;
+        request = CancelReplaceRequest();
+        return parseCancelReplaceMessage(message, request, tickSizeOf);
+    };
+    ASSERT_EQ(parseRequest("REPLACE:parser_trader:PARSE:ORD_12:10.05:3"), OrderRejectReason::NONE);
+    EXPECT_FALSE(request.isCancel);
+    EXPECT_EQ(request.traderId, "parser_trader");
+    EXPECT_EQ(request.symbol, SymbolRegistry::instance().find("PARSE"));
+    EXPECT_EQ(request.orderId, 12u);
+    EXPECT_EQ(request.price, 201);
+    EXPECT_DOUBLE_EQ(request.quantity, 3.0);
+    ASSERT_EQ(parseRequest("CANCEL:parser_trader:PARSE:12"), OrderRejectReason::NONE);
+    EXPECT_TRUE(request.isCancel);
+    EXPECT_EQ(request.orderId, 12u);
+    EXPECT_EQ(parseRequest("CANCEL:parser_trader:PARSE"), OrderRejectReason::MALFORMED);
+    EXPECT_EQ(parseRequest("CANCEL:parser_trader:PARSE:ORD_x"), OrderRejectReason::MALFORMED);
+    EXPECT_EQ(parseRequest("REPLACE:parser_trader:PARSE:ORD_12:10.05:3:4"), OrderRejectReason::MALFORMED);
+    EXPECT_EQ(parseRequest("REPLACE:parser_trader:PARSE:ORD_12:0:3"), OrderRejectReason::INVALID_PRICE);
+    EXPECT_EQ(parseRequest("REPLACE:parser_trader:PARSE:ORD_12:10.01:3"), OrderRejectReason::INVALID_PRICE);
+    EXPECT_EQ(parseRequest("REPLACE:parser_trader:PARSE:ORD_12:10.05:nan"), OrderRejectReason::INVALID_QUANTITY);
+
+    // A symbol no order has used is refused without registering it
+    size_t symbolCount = SymbolRegistry::instance().size();
+    EXPECT_EQ(parseRequest("CANCEL:parser_trader:NEVER_SEEN:12"), OrderRejectReason::UNKNOWN_SYMBOL);
+    EXPECT_EQ(SymbolRegistry::instance().find("NEVER_SEEN"), kInvalidSymbolId);
+    EXPECT_EQ(SymbolRegistry::instance().size(), symbolCount);
+}
+
+// Test 33: Session outboxes write queued messages in order and apply the slow-consumer policy
+TEST(SessionReactorTest, OutboxAppliesSlowConsumerPolicy) {
+    int sockets[2];
+    ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, sockets), 0);
+    int bufferSize = 4096; // Small send buffer so the outbox has to hold the backlog
+    setsockopt(sockets[0], SOL_SOCKET, SO_SNDBUF, &bufferSize, sizeof(bufferSize));
+    int peer = sockets[1];
+
+    std::mutex outboxMutex;
+    std::shared_ptr<SessionOutbox> outbox;
+    std::atomic<bool> closed(false);
+    SessionReactor reactor(
+        [&](Session& session) {
+            std::lock_guard<std::mutex> lock(outboxMutex);
+            outbox = session.outbox;
+            std::string_view line;
+            while (session.inbound.nextLine(line)) {}
+            return true;
+        },
+        [&](Session&) { closed = true; });
+    reactor.setSlowConsumerPolicy(SlowConsumerPolicy::DROP, 2048);
+    reactor.start();
+    ASSERT_TRUE(reactor.addSession(sockets[0]));
+    ASSERT_EQ(send(peer, "HELLO\n", 6, 0), 6);
+    for (int i = 0; i < 100; ++i) {
+        std::lock_guard<std::mutex> lock(outboxMutex);
+        if (outbox) {
+            break;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+    std::shared_ptr<SessionOutbox> session;
+    {
+        std::lock_guard<std::mutex> lock(outboxMutex);
+        session = outbox;
+    }
+    ASSERT_TRUE(session);
+
+    // Everything the peer receives until it has been quiet for a while
+    auto drain = [peer]() {
+        std::string received;
+        char buffer[4096];
+        struct pollfd pfd = {peer, POLLIN, 0};
+        while (poll(&pfd, 1, 200) > 0) {
+            ssize_t bytesRead = recv(peer, buffer, sizeof(buffer), 0);
+            if (bytesRead <= 0) {
+                break;
+            }
+            received.append(buffer, static_cast<size_t>(bytesRead));
+        }
+        return received;
+    };
+    auto message = [](const char* prefix, int n) {
+        char text[64];
+        std::snprintf(text, sizeof(text), "%s:%04d:%040d\n", prefix, n, 0);
+        return std::string(text);
+    };
+
+    // DROP: the peer is not reading, so later messages are refused; the ones
+    // accepted arrive complete and in order
+    std::string expected;
+    size_t refused = 0;
+    for (int i = 0; i < 500; ++i) {
+        if (session->send(message("DROP", i))) {
+            expected += message("DROP", i);
+        } else {
+            ++refused;
+        }
+    }
+    EXPECT_GT(refused, 0u);
+    EXPECT_EQ(session->getDroppedCount(), refused);
+    EXPECT_EQ(drain(), expected);
+
+    // CONFLATE: keyed messages replace their queued predecessor, so the latest always gets through
+    reactor.setSlowConsumerPolicy(SlowConsumerPolicy::CONFLATE, 2048);
+    for (int i = 0; i < 500; ++i) {
+        EXPECT_TRUE(session->send(message("KEYED", i), 1));
+    }
+    std::string conflated = drain();
+    EXPECT_LT(conflated.size(), 500 * message("KEYED", 0).size());
+    ASSERT_GE(conflated.size(), message("KEYED", 499).size());
+    EXPECT_EQ(conflated.substr(conflated.size() - message("KEYED", 499).size()), message("KEYED", 499));
+
+    // DISCONNECT: overflowing the backlog closes the session
+    reactor.setSlowConsumerPolicy(SlowConsumerPolicy::DISCONNECT, 2048);
+    bool refusedAny = false;
+    for (int i = 0; i < 500 && !refusedAny; ++i) {
+        refusedAny = !session->send(message("CLOSE", i));
+    }
+    EXPECT_TRUE(refusedAny);
+    drain();
+    for (int i = 0; i < 100 && !closed; ++i) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+    EXPECT_TRUE(closed);
+    EXPECT_FALSE(session->send("AFTER_CLOSE\n"));
+
+    reactor.stop();
+    close(peer);
+}
+
+// Test 34: An order far from the touch does not blow up the ladder; it rests in the overflow tree
+TEST(OrderBookTest, LadderKeepsFarPricesOutOfTheWindow) {
+    OrderBook treeBook("AAPL", 0.01, BookMode::TREE);
+    OrderBook ladderBook("AAPL", 0.01, BookMode::LADDER);
+
+    // Near the touch, then far enough away that covering both would take
+    // gigabytes of ladder, then at the very edge of the Price range
+    const Price prices[] = {15000, 15001, 1000000000000, 14999,
+                            std::numeric_limits<Price>::max() - 1, 1, 15002};
+    OrderId nextId = 1;
+    for (Price price : prices) {
+        for (OrderSide side : {OrderSide::BUY, OrderSide::SELL}) {
+            Order order;
+            order.orderId = nextId++;
+            order.side = side;
+            order.type = OrderType::LIMIT;
+            order.price = price;
+            order.quantity = 1;
+            treeBook.addOrder(order);
+            ladderBook.addOrder(order);
+        }
+    }
+
+    auto sameOrders = [](const std::vector<Order>& expected, const std::vector<Order>& actual) {
+        ASSERT_EQ(expected.size(), actual.size());
+        for (size_t i = 0; i < expected.size(); ++i) {
+            EXPECT_EQ(expected[i].orderId, actual[i].orderId);
+            EXPECT_EQ(expected[i].price, actual[i].price);
+        }
+    };
+    EXPECT_EQ(ladderBook.getBestBidTicks(), std::numeric_limits<Price>::max() - 1);
+    EXPECT_EQ(ladderBook.getBestAskTicks(), 1);
+    sameOrders(treeBook.getBuyOrders(), ladderBook.getBuyOrders());
+    sameOrders(treeBook.getSellOrders(), ladderBook.getSellOrders());
+
+    // Removing the far levels leaves the near ones as the touch
+    for (OrderId orderId = 1; orderId < nextId; ++orderId) {
+        Price price = prices[(orderId - 1) / 2];
+        if (price > 1000000 || price == 1) {
+            EXPECT_EQ(treeBook.removeOrder(orderId), ladderBook.removeOrder(orderId));
+        }
+    }
+    EXPECT_EQ(ladderBook.getBestBidTicks(), 15002);
+    EXPECT_EQ(ladderBook.getBestAskTicks(), 14999);
+    sameOrders(treeBook.getBuyOrders(), ladderBook.getBuyOrders());
+    sameOrders(treeBook.getSellOrders(), ladderBook.getSellOrders());
+
+    // A far level can be re-used and fully drained
+    Order far;
+    far.orderId = nextId++;
+    far.side = OrderSide::BUY;
+    far.type = OrderType::LIMIT;
+    far.price = 1000000000000;
+    far.quantity = 1;
+    ladderBook.addOrder(far);
+    EXPECT_EQ(ladderBook.getBestBidTicks(), far.price);
+    EXPECT_TRUE(ladderBook.removeOrder(far.orderId));
+    EXPECT_EQ(ladderBook.getBestBidTicks(), 15002);
+}
+
+// Test 35: A book snapshot is a detached copy that later book changes don't touch
+TEST(OrderBookTest, SnapshotIsDetachedFromTheBook) {
+    OrderBook orderBook("AAPL");
+    Order order;
+    order.orderId = 1;
+    order.traderId = "trader1";
+    order.side = OrderSide::BUY;
+    order.type = OrderType::LIMIT;
+    order.price = 15000;
+    order.quantity = 10;
+    orderBook.addOrder(order);
+    order.orderId = 2;
+    order.side = OrderSide::SELL;
+    order.price = 15010;
+    orderBook.addOrder(order);
+
+    // A bid level per tick below; the snapshot keeps only the top ones
+    for (OrderId id = 3; id < 3 + kSnapshotDepth; ++id) {
+        order.orderId = id;
+        order.side = OrderSide::BUY;
+        order.price = 15000 - static_cast<Price>(id);
+        orderBook.addOrder(order);
+    }
+
+    OrderBookSnapshot snapshot = orderBook.takeSnapshot();
+    RestingOrdersSnapshot orders = orderBook.takeOrdersSnapshot();
+    orderBook.removeOrder(1);
+    orderBook.removeOrder(2);
+
+    EXPECT_EQ(snapshot.symbol, "AAPL");
+    EXPECT_EQ(snapshot.bestBid, 15000);
+    EXPECT_EQ(snapshot.bestAsk, 15010);
+    EXPECT_EQ(snapshot.orders, nullptr);
+    ASSERT_EQ(snapshot.bids.size(), kSnapshotDepth);
+    EXPECT_EQ(snapshot.bids[0].price, 15000);
+    ASSERT_EQ(snapshot.asks.size(), 1u);
+    EXPECT_DOUBLE_EQ(snapshot.asks[0].quantity, 10.0);
+    ASSERT_EQ(orders.buyOrders.size(), kSnapshotDepth + 1);
+    EXPECT_EQ(orders.buyOrders[0].traderId, "trader1");
+    EXPECT_EQ(orderBook.getOrderCount(), kSnapshotDepth);
+}
+
+// Test 36: A triggered stop that finds no liquidity is cancelled and reported, not lost
+TEST(MatchingEngineTest, TriggeredStopWithoutLiquidityIsReported) {
+    OrderBook orderBook("AAPL");
+    MatchingEngine matchingEngine;
+
+    Order bid;
+    bid.orderId = 1;
+    bid.side = OrderSide::BUY;
+    bid.type = OrderType::LIMIT;
+    bid.price = 9900;
+    bid.quantity = 5;
+    matchingEngine.submitOrder(bid, orderBook);
+
+    Order sellStop;
+    sellStop.orderId = 2;
+    sellStop.side = OrderSide::SELL;
+    sellStop.type = OrderType::STOP;
+    sellStop.stopPrice = 9900;
+    sellStop.quantity = 5;
+    matchingEngine.submitOrder(sellStop, orderBook);
+    EXPECT_EQ(orderBook.getStopOrderCount(), 1u);
+
+    // Taking the only bid triggers the stop, which has nothing left to sell into
+    Order sell;
+    sell.orderId = 3;
+    sell.side = OrderSide::SELL;
+    sell.type = OrderType::MARKET;
+    sell.quantity = 5;
+    auto trades = matchingEngine.submitOrder(sell, orderBook);
+    ASSERT_EQ(trades.size(), 1u);
+    EXPECT_EQ(sell.status, OrderStatus::FILLED);
+    EXPECT_EQ(orderBook.getStopOrderCount(), 0u);
+    EXPECT_EQ(orderBook.getOrderCount(), 0u);
+
+    const auto& cancels = matchingEngine.getEngineCancels();
+    ASSERT_EQ(cancels.size(), 1u);
+    EXPECT_EQ(cancels[0].orderId, 2u);
+    EXPECT_EQ(cancels[0].status, OrderStatus::CANCELLED);
+    EXPECT_DOUBLE_EQ(cancels[0].filledQuantity, 0.0);
+
+    // A market order with nothing to match is cancelled rather than left pending
+    Order buy;
+    buy.orderId = 4;
+    buy.side = OrderSide::BUY;
+    buy.type = OrderType::MARKET;
+    buy.quantity = 5;
+    EXPECT_TRUE(matchingEngine.submitOrder(buy, orderBook).empty());
+    EXPECT_EQ(buy.status, OrderStatus::CANCELLED);
+}
+
+// Test 37: A session cannot cancel or replace another trader's orders
+TEST_F(MarketServerTest, SessionsOnlyCancelTheirOwnOrders) {
+    TestClient owner("127.0.0.1", port_);
+    TestClient intruder("127.0.0.1", port_);
+    ASSERT_TRUE(owner.connect());
+    ASSERT_TRUE(intruder.connect());
+    ASSERT_TRUE(owner.registerTrader("owner_trader"));
+    ASSERT_TRUE(intruder.registerTrader("intruder_trader"));
+
+    std::string response = owner.sendMessage("ORDER:owner_trader:OWNR:BUY:LIMIT:10.00:5");
+    ASSERT_EQ(response.find("ORDER_ACCEPTED:ORD_"), 0u) << response;
+    std::string orderId = response.substr(15, response.find_first_of(":\n", 15) - 15);
+
+    // Naming the owner in the request does not help, nor does naming yourself
+    for (const std::string& request : {"CANCEL:owner_trader:OWNR:" + orderId,
+                                       "REPLACE:owner_trader:OWNR:" + orderId + ":10.00:1",
+                                       "CANCEL:intruder_trader:OWNR:" + orderId}) {
+        response = intruder.sendMessage(request);
+        EXPECT_NE(response.find("_REJECTED:" + orderId + ":Unknown order"), std::string::npos)
+            << request << " -> " << response;
+    }
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    const OrderBook& orderBook = server_->getOrderBook("OWNR");
+    EXPECT_EQ(orderBook.getOrderCount(), 1u);
+    EXPECT_EQ(orderBook.getBestBidTicks(), 1000);
+
+    // The owner can
+    response = owner.sendMessage("CANCEL:owner_trader:OWNR:" + orderId);
+    EXPECT_EQ(response.find("ORDER_CANCELLED:" + orderId), 0u) << response;
+}
+
+// Test 38: Binary rejects carry the same reason a text session would get, and non-finite numbers are refused
+TEST_F(MarketServerTest, BinaryRejectsCarryTheReason) {
+    TestClient trader("127.0.0.1", port_);
+    ASSERT_TRUE(trader.connect());
+    EXPECT_EQ(trader.sendMessage("REGISTER:binary_rejects:BINARY"), "REGISTERED:binary_rejects:BINARY");
+
+    BinaryNewOrder base = makeBinaryMessage<BinaryNewOrder>();
+    base.side = static_cast<uint8_t>(OrderSide::BUY);
+    base.orderType = static_cast<uint8_t>(OrderType::LIMIT);
+    setBinarySymbol(base.symbol, "BREJ");
+    base.price = 1000;
+    base.quantity = 5;
+    BinaryNewOrder infinite = base;
+    infinite.clientOrderId = 1;
+    infinite.quantity = std::numeric_limits<double>::infinity();
+    BinaryNewOrder nanDisplay = base;
+    nanDisplay.clientOrderId = 2;
+    nanDisplay.displayQuantity = std::numeric_limits<double>::quiet_NaN();
+    BinaryNewOrder freeLimit = base;
+    freeLimit.clientOrderId = 3;
+    freeLimit.price = 0;
+    BinaryReplace replace = makeBinaryMessage<BinaryReplace>();
+    setBinarySymbol(replace.symbol, "BREJ");
+    replace.orderId = 42;
+    replace.price = 1000;
+    replace.quantity = std::numeric_limits<double>::infinity();
+    std::string bytes;
+    appendBinaryMessage(bytes, infinite);
+    appendBinaryMessage(bytes, nanDisplay);
+    appendBinaryMessage(bytes, freeLimit);
+    appendBinaryMessage(bytes, replace);
+    ASSERT_TRUE(trader.sendRaw(bytes));
+
+    FrameBuffer inbound;
+    std::vector<BinaryReject> rejects;
+    std::string_view frame;
+    for (int i = 0; i < 40 && rejects.size() < 4; ++i) {
+        std::string received = trader.receiveRaw(25);
+        std::memcpy(inbound.prepare(received.size()), received.data(), received.size());
+        inbound.commit(received.size());
+        while (inbound.nextFrame(frame)) {
+            ASSERT_TRUE(decodeBinaryMessage(frame, rejects.emplace_back()));
+        }
+    }
+    ASSERT_EQ(rejects.size(), 4u);
+    EXPECT_EQ(rejects[0].reason, BinaryRejectReason::INVALID_QUANTITY);
+    EXPECT_EQ(rejects[0].clientOrderId, 1u);
+    EXPECT_EQ(rejects[1].reason, BinaryRejectReason::INVALID_FIELD);
+    EXPECT_EQ(rejects[1].clientOrderId, 2u);
+    EXPECT_EQ(rejects[2].reason, BinaryRejectReason::INVALID_PRICE);
+    EXPECT_EQ(rejects[2].clientOrderId, 3u);
+    EXPECT_EQ(rejects[3].reason, BinaryRejectReason::INVALID_REPLACE);
+    EXPECT_EQ(rejects[3].orderId, 42u);
+}
+
+// Test 39: Only operator sessions can change a symbol's trading phase
+TEST_F(MarketServerTest, AuctionControlRequiresOperator) {
+    server_->addOperator("auction_ops");
+    TestClient trader("127.0.0.1", port_);
+    TestClient ops("127.0.0.1", port_);
+    ASSERT_TRUE(trader.connect());
+    ASSERT_TRUE(ops.connect());
+    ASSERT_TRUE(trader.registerTrader("auction_trader"));
+    ASSERT_TRUE(ops.registerTrader("auction_ops"));
+
+    std::string response = trader.sendMessage("AUCTION:AUCT:START");
+    EXPECT_EQ(response.find("ERROR:Not authorized"), 0u) << response;
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    EXPECT_EQ(server_->getOrderBook("AUCT").getTradingPhase(), TradingPhase::CONTINUOUS);
+
+    response = ops.sendMessage("AUCTION:AUCT:START");
+    EXPECT_EQ(response.find("AUCTION_ACCEPTED:AUCT:START"), 0u) << response;
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    EXPECT_EQ(server_->getOrderBook("AUCT").getTradingPhase(), TradingPhase::CALL_AUCTION);
+}